@@ -0,0 +1,181 @@
+#pragma once
+
+// Reference pools the comparison harness runs alongside PriorityThreadPool. They take the same
+// add(task, priority) call so workloads can be written once; the priority is ignored.
+#include <deque>
+#include <mutex>
+#include <random>
+#include "../priority_thread_pool.h"
+
+namespace bench {
+
+// Plain FIFO pool: one std::mutex protected queue and one condition variable
+class FifoPool {
+public:
+    explicit FifoPool(const size_t workers) {
+        for (size_t i = 0; i < workers; ++i) {
+            m_threads.emplace_back([this] {
+                while (true) {
+                    std::unique_lock lock(m_mutex);
+                    m_cv.wait(lock, [this] { return m_quit || !m_tasks.empty(); });
+                    if (m_tasks.empty()) {
+                        return;
+                    }
+                    auto task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                    lock.unlock();
+                    task();
+                }
+            });
+        }
+    }
+
+    ~FifoPool() {
+        {
+            std::lock_guard guard(m_mutex);
+            m_quit = true;
+        }
+        m_cv.notify_all();
+    }
+
+    void add(Task task, Priority = Priority::Normal) {
+        {
+            std::lock_guard guard(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    bool                      m_quit{ false };
+    std::deque<Task>          m_tasks;
+    std::mutex                m_mutex;
+    std::condition_variable   m_cv;
+    std::vector<std::jthread> m_threads;    // Declared last so workers are joined first
+};
+
+// Work-stealing pool: each worker owns a deque, runs its newest task first and steals the
+// oldest task of another worker when its own deque is empty
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(const size_t workers) : m_queues(workers) {
+        for (size_t i = 0; i < workers; ++i) {
+            m_threads.emplace_back([this, i] {
+                t_self = this;
+                t_index = i;
+                std::minstd_rand random(static_cast<unsigned>(i));
+                while (true) {
+                    Task task;
+                    if (pop(i, task) || steal(i, random, task)) {
+                        m_pending.fetch_sub(1, std::memory_order_relaxed);
+                        task();
+                        continue;
+                    }
+                    std::unique_lock lock(m_sleepMutex);
+                    m_sleep.wait(lock, [this] { return m_quit || m_pending.load() > 0; });
+                    if (m_quit && m_pending.load() == 0) {
+                        return;
+                    }
+                }
+            });
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard guard(m_sleepMutex);
+            m_quit = true;
+        }
+        m_sleep.notify_all();
+    }
+
+    void add(Task task, Priority = Priority::Normal) {
+        // Workers push to their own deque, other threads spread tasks round-robin
+        const auto index = t_self == this ? t_index : m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        {
+            std::lock_guard guard(m_queues[index].mutex);
+            m_queues[index].tasks.push_back(std::move(task));
+        }
+        m_pending.fetch_add(1);
+        { std::lock_guard guard(m_sleepMutex); }    // Order with workers about to sleep
+        m_sleep.notify_one();
+    }
+
+private:
+    struct Queue {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(const size_t index, Task& task) {
+        auto& queue = m_queues[index];
+        std::lock_guard guard(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(const size_t index, std::minstd_rand& random, Task& task) {
+        const auto start = random();
+        for (size_t i = 0; i < m_queues.size(); ++i) {
+            const auto victim = (start + i) % m_queues.size();
+            if (victim == index) {
+                continue;
+            }
+            auto& queue = m_queues[victim];
+            std::lock_guard guard(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static inline thread_local WorkStealingPool* t_self = nullptr;   // Pool of the calling worker
+    static inline thread_local size_t            t_index = 0;        // Index of the calling worker
+
+    std::vector<Queue>          m_queues;
+    std::atomic_size_t          m_next{ 0 };
+    std::atomic_int64_t         m_pending{ 0 };
+    bool                        m_quit{ false };
+    std::mutex                  m_sleepMutex;
+    std::condition_variable     m_sleep;
+    std::vector<std::jthread>   m_threads;    // Declared last so workers are joined first
+};
+
+// No pool at all: every task gets its own thread
+class ThreadPerTask {
+public:
+    explicit ThreadPerTask(size_t) {
+    }
+
+    ~ThreadPerTask() {
+        // Tasks may add more tasks while earlier threads are joined
+        while (true) {
+            std::vector<std::jthread> threads;
+            {
+                std::lock_guard guard(m_mutex);
+                if (m_threads.empty()) {
+                    return;
+                }
+                threads.swap(m_threads);
+            }
+        }
+    }
+
+    void add(Task task, Priority = Priority::Normal) {
+        std::lock_guard guard(m_mutex);
+        m_threads.emplace_back(std::move(task));
+    }
+
+private:
+    std::mutex                m_mutex;
+    std::vector<std::jthread> m_threads;
+};
+
+} // namespace bench
@@ -0,0 +1,159 @@
+#pragma once
+
+// Helpers shared by the benchmark programs: timing, percentiles and JSON result output.
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <string_view>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+// Nanoseconds elapsed since the given time point
+[[nodiscard]] inline double nanosecondsSince(const Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Spin until the counter reaches the expected value
+inline void waitFor(const std::atomic_uint64_t& counter, const uint64_t expected) {
+    while (counter.load(std::memory_order_acquire) < expected) {
+        std::this_thread::yield();
+    }
+}
+
+// Latency distribution summary, in nanoseconds
+struct Percentiles {
+    double p50{ 0 };
+    double p90{ 0 };
+    double p99{ 0 };
+    double p999{ 0 };
+    double max{ 0 };
+};
+
+// Compute percentiles of the samples; the samples are sorted in place
+[[nodiscard]] inline Percentiles percentiles(std::vector<double>& samples) {
+    if (samples.empty()) {
+        return {};
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto at = [&samples](const double fraction) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(fraction * static_cast<double>(samples.size())))];
+    };
+    return { at(0.50), at(0.90), at(0.99), at(0.999), samples.back() };
+}
+
+// One benchmark result: a name, its parameters and its measured metrics
+struct Result {
+    std::string                                   name;
+    std::vector<std::pair<std::string, double>>   params;
+    std::vector<std::pair<std::string, double>>   metrics;
+
+    // Add the percentiles of a latency distribution as metrics with the given prefix
+    Result& latency(const std::string& prefix, const Percentiles& latency) {
+        metrics.emplace_back(prefix + "_p50_ns", latency.p50);
+        metrics.emplace_back(prefix + "_p90_ns", latency.p90);
+        metrics.emplace_back(prefix + "_p99_ns", latency.p99);
+        metrics.emplace_back(prefix + "_p999_ns", latency.p999);
+        metrics.emplace_back(prefix + "_max_ns", latency.max);
+        return *this;
+    }
+};
+
+// Collects results, prints them as they arrive and writes them as JSON at the end
+class Reporter {
+public:
+    // Parse `--json <file>`, `--filter <name>` and `--quick` from the command line
+    Reporter(const int argc, char* argv[]) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg(argv[i]);
+            if (arg == "--json" && i + 1 < argc) {
+                m_jsonPath = argv[++i];
+            } else if (arg == "--filter" && i + 1 < argc) {
+                m_filter = argv[++i];
+            } else if (arg == "--quick") {
+                m_quick = true;
+            } else {
+                std::cerr << "Usage: " << argv[0] << " [--quick] [--json <file>] [--filter <name>]" << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+
+    ~Reporter() {
+        if (m_jsonPath.empty()) {
+            return;
+        }
+        std::ofstream file(m_jsonPath);
+        file << std::setprecision(10) << "{\"results\":[";
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            const auto& result = m_results[i];
+            file << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << result.name << "\",\"params\":{";
+            writeValues(file, result.params);
+            file << "},\"metrics\":{";
+            writeValues(file, result.metrics);
+            file << "}}";
+        }
+        file << "\n]}\n";
+    }
+
+    // Whether smaller problem sizes were requested
+    [[nodiscard]] bool quick() const {
+        return m_quick;
+    }
+
+    // Whether the scenario with the given name was selected by --filter
+    [[nodiscard]] bool selected(const std::string_view name) const {
+        return m_filter.empty() || name.find(m_filter) != std::string_view::npos;
+    }
+
+    // Scale a problem size down in quick mode
+    [[nodiscard]] uint64_t size(const uint64_t full) const {
+        return m_quick ? std::max<uint64_t>(1, full / 10) : full;
+    }
+
+    // Stop printing each result as it arrives, for programs that print their own tables
+    void quiet() {
+        m_echo = false;
+    }
+
+    // Print and keep a result
+    void add(Result result) {
+        if (!m_echo) {
+            m_results.push_back(std::move(result));
+            return;
+        }
+        std::cout << std::left << std::setw(28) << result.name << std::setprecision(10);
+        for (const auto& [key, value] : result.params) {
+            std::cout << ' ' << key << '=' << value;
+        }
+        std::cout << "\n   ";
+        for (const auto& [key, value] : result.metrics) {
+            std::cout << ' ' << key << '=' << std::fixed << std::setprecision(1) << value << std::defaultfloat;
+        }
+        std::cout << std::endl;
+        m_results.push_back(std::move(result));
+    }
+
+private:
+    static void writeValues(std::ostream& os, const std::vector<std::pair<std::string, double>>& values) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            os << (i == 0 ? "" : ",") << '"' << values[i].first << "\":" << values[i].second;
+        }
+    }
+
+    std::string         m_jsonPath;          // Where to write JSON results, empty for none
+    std::string         m_filter;            // Only run scenarios whose name contains this
+    bool                m_quick{ false };    // Whether to run smaller problem sizes
+    bool                m_echo{ true };      // Whether results are printed as they arrive
+    std::vector<Result> m_results;           // Results collected so far
+};
+
+} // namespace bench
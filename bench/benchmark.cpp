@@ -0,0 +1,358 @@
+// Benchmark suite for PriorityThreadPool: throughput, dispatch latency, bulk submission,
+// priority flips, memory per queued task and High/Realtime latency under a Lowest flood.
+//
+// Build: g++ -std=c++20 -O2 -DNDEBUG benchmark.cpp -o benchmark -pthread
+// Run:   ./benchmark [--quick] [--json results.json] [--filter scenario]
+#include <new>
+#include <cstdlib>
+#include <malloc.h>         // For malloc_usable_size, or _msize on Windows
+#include "bench_util.h"
+#include "../priority_thread_pool.h"
+
+// Live heap bytes, tracked by the replacement allocation functions below
+static std::atomic_int64_t g_liveBytes{ 0 };
+
+// Usable size of a block returned by malloc
+static size_t blockSize(void* pointer) {
+#ifdef _WIN32
+    return _msize(pointer);
+#else
+    return malloc_usable_size(pointer);
+#endif
+}
+
+// Kept out of line so GCC does not pair the inlined malloc and free with new and delete expressions
+[[gnu::noinline]] void* operator new(const size_t size) {
+    const auto pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    g_liveBytes.fetch_add(static_cast<int64_t>(blockSize(pointer)), std::memory_order_relaxed);
+    return pointer;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    if (pointer != nullptr) {
+        g_liveBytes.fetch_sub(static_cast<int64_t>(blockSize(pointer)), std::memory_order_relaxed);
+        std::free(pointer);
+    }
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+// Over-aligned allocations, used by std::pmr::new_delete_resource() for the queue's storage
+[[gnu::noinline]] void* operator new(const size_t size, const std::align_val_t alignment) {
+    const auto align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+    const auto pointer = _aligned_malloc(size == 0 ? 1 : size, align);
+    const auto bytes = pointer != nullptr ? _aligned_msize(pointer, align, 0) : 0;
+#else
+    const auto pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+    const auto bytes = pointer != nullptr ? blockSize(pointer) : 0;
+#endif
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    g_liveBytes.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+    return pointer;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, const std::align_val_t alignment) noexcept {
+    if (pointer != nullptr) {
+#ifdef _WIN32
+        g_liveBytes.fetch_sub(static_cast<int64_t>(_aligned_msize(pointer, static_cast<size_t>(alignment), 0)),
+                              std::memory_order_relaxed);
+        _aligned_free(pointer);
+#else
+        static_cast<void>(alignment);
+        g_liveBytes.fetch_sub(static_cast<int64_t>(blockSize(pointer)), std::memory_order_relaxed);
+        std::free(pointer);
+#endif
+    }
+}
+
+void operator delete(void* pointer, size_t, const std::align_val_t alignment) noexcept {
+    operator delete(pointer, alignment);
+}
+
+namespace {
+
+const auto HardwareThreads = static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()));
+
+// Worker counts to sweep: 1, 2, 4, ... up to the hardware concurrency
+std::vector<size_t> workerCounts() {
+    std::vector<size_t> counts;
+    for (size_t workers = 1; workers < HardwareThreads; workers *= 2) {
+        counts.push_back(workers);
+    }
+    counts.push_back(HardwareThreads);
+    return counts;
+}
+
+// Occupies every worker of a pool until released, so tasks added meanwhile stay queued
+class WorkerGate {
+public:
+    WorkerGate(PriorityThreadPool& pool, const size_t workers) {
+        for (size_t i = 0; i < workers; ++i) {
+            pool.add([this] {
+                m_running.fetch_add(1, std::memory_order_release);
+                m_open.wait(false);
+            }, Priority::Realtime);
+        }
+        bench::waitFor(m_running, workers);
+    }
+
+    ~WorkerGate() {
+        open();
+    }
+
+    void open() {
+        m_open.store(true);
+        m_open.notify_all();
+    }
+
+private:
+    std::atomic_uint64_t m_running{ 0 };
+    std::atomic_bool     m_open{ false };
+};
+
+// Empty tasks per second for a number of producers and workers
+void throughput(bench::Reporter& reporter) {
+    const auto tasks = reporter.size(1000000);
+    for (const auto workers : workerCounts()) {
+        for (const size_t producers : { size_t{ 1 }, size_t{ 2 }, size_t{ 4 } }) {
+            std::atomic_uint64_t done{ 0 };
+            double elapsed = 0;
+            {
+                PriorityThreadPool pool(workers);
+                const auto start = bench::Clock::now();
+                std::vector<std::jthread> threads;
+                for (size_t p = 0; p < producers; ++p) {
+                    threads.emplace_back([&pool, &done, count = tasks / producers] {
+                        for (uint64_t i = 0; i < count; ++i) {
+                            pool.add([&done] { done.fetch_add(1, std::memory_order_release); });
+                        }
+                    });
+                }
+                threads.clear();
+                bench::waitFor(done, tasks / producers * producers);
+                elapsed = bench::nanosecondsSince(start);
+            }
+            reporter.add({ "throughput", { { "workers", double(workers) }, { "producers", double(producers) } },
+                { { "tasks_per_second", double(done) * 1e9 / elapsed }, { "ns_per_task", elapsed / double(done) } } });
+        }
+    }
+}
+
+// Submit-to-start latency of a task submitted to an idle pool
+void dispatchLatency(bench::Reporter& reporter) {
+    const auto samples = reporter.size(20000);
+    for (const auto workers : workerCounts()) {
+        PriorityThreadPool pool(workers);
+        std::vector<double> latencies(samples);
+        std::atomic_uint64_t done{ 0 };
+        for (uint64_t i = 0; i < samples; ++i) {
+            const auto submitted = bench::Clock::now();
+            pool.add([&latencies, &done, submitted, i] {
+                latencies[i] = bench::nanosecondsSince(submitted);
+                done.fetch_add(1, std::memory_order_release);
+            });
+            bench::waitFor(done, i + 1);
+        }
+        reporter.add(bench::Result{ "dispatch_latency", { { "workers", double(workers) } }, {} }
+            .latency("submit_to_start", bench::percentiles(latencies)));
+    }
+}
+
+// Submit-to-start latency of Realtime tasks taken by a parked worker and by a dedicated spinner
+void realtimeSpin(bench::Reporter& reporter) {
+    if (HardwareThreads < 2) {
+        std::cerr << "realtime_spin skipped: the spinner needs a core of its own" << std::endl;
+        return;
+    }
+    const auto samples = reporter.size(20000);
+    const int core = static_cast<int>(HardwareThreads - 1);
+    for (const bool spinning : { false, true }) {
+        PriorityThreadPool pool(1);
+        if (spinning && !pool.startRealtimeSpinners(std::span(&core, 1))) {
+            std::cerr << "realtime_spin skipped: cannot pin a spinner to core " << core << std::endl;
+            return;
+        }
+        std::vector<double> latencies(samples);
+        std::atomic_uint64_t done{ 0 };
+        for (uint64_t i = 0; i < samples; ++i) {
+            const auto submitted = bench::Clock::now();
+            pool.add([&latencies, &done, submitted, i] {
+                latencies[i] = bench::nanosecondsSince(submitted);
+                done.fetch_add(1, std::memory_order_release);
+            }, Priority::Realtime);
+            bench::waitFor(done, i + 1);
+        }
+        reporter.add(bench::Result{ "realtime_spin", { { "spinning", double(spinning) } }, {} }
+            .latency("submit_to_start", bench::percentiles(latencies)));
+    }
+}
+
+// Producer-side cost of add(span) compared to individual add() calls
+void bulkAdd(bench::Reporter& reporter) {
+    for (const uint64_t batch : { 16, 256, 4096 }) {
+        const auto rounds = std::max<uint64_t>(1, reporter.size(1000000) / batch);
+        double single = 0, bulk = 0;
+        std::atomic_uint64_t done{ 0 };
+        PriorityThreadPool pool(HardwareThreads);
+        for (uint64_t round = 0; round < rounds; ++round) {
+            std::vector<TaskPriority> tasks;
+            tasks.reserve(batch);
+            for (uint64_t i = 0; i < batch; ++i) {
+                tasks.emplace_back([&done] { done.fetch_add(1, std::memory_order_release); }, Priority::Normal);
+            }
+            auto start = bench::Clock::now();
+            pool.add(tasks);
+            bulk += bench::nanosecondsSince(start);
+
+            start = bench::Clock::now();
+            for (const auto& task : tasks) {
+                pool.add(task.first, task.second);
+            }
+            single += bench::nanosecondsSince(start);
+        }
+        bench::waitFor(done, 2 * rounds * batch);
+        const auto total = double(rounds * batch);
+        reporter.add({ "bulk_add", { { "batch", double(batch) } },
+            { { "bulk_ns_per_task", bulk / total }, { "single_ns_per_task", single / total } } });
+    }
+}
+
+// Per-task cost when every task has a different priority than the previous one on its worker
+void priorityFlip(bench::Reporter& reporter) {
+    const auto tasks = reporter.size(20000);
+    for (const bool flip : { false, true }) {
+        for (const bool osPriority : { false, true }) {
+            PriorityThreadPool pool(1);
+            pool.setOsPriorityEnabled(osPriority);
+            std::atomic_uint64_t done{ 0 };
+            const auto start = bench::Clock::now();
+            for (uint64_t i = 0; i < tasks; ++i) {  // One task at a time so the queue cannot reorder them
+                const auto priority = flip && i % 2 == 1 ? Priority::High : Priority::Low;
+                pool.add([&done] { done.fetch_add(1, std::memory_order_release); }, priority);
+                bench::waitFor(done, i + 1);
+            }
+            const auto elapsed = bench::nanosecondsSince(start);
+            const auto stats = pool.stats();
+            reporter.add({ "priority_flip", { { "flip", double(flip) }, { "os_priority", double(osPriority) } },
+                { { "ns_per_task", elapsed / double(tasks) }, { "os_priority_changes", double(stats.priorityChanges) },
+                  { "os_priority_failures", double(stats.priorityChangeFailures) } } });
+        }
+    }
+}
+
+// Heap bytes held per queued task, for a capture that fits std::function's small buffer and one that does not
+void memoryPerTask(bench::Reporter& reporter) {
+    const auto tasks = reporter.size(100000);
+    for (const size_t captureBytes : { size_t{ 8 }, size_t{ 64 } }) {
+        PriorityThreadPool pool(1);
+        WorkerGate gate(pool, 1);
+        const auto before = g_liveBytes.load();
+        std::atomic_uint64_t done{ 0 };
+        for (uint64_t i = 0; i < tasks; ++i) {
+            if (captureBytes == 8) {
+                pool.add([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            } else {
+                pool.add([&done, padding = std::array<char, 56>{}] { done.fetch_add(padding[0] + 1, std::memory_order_relaxed); });
+            }
+        }
+        const auto bytes = double(g_liveBytes.load() - before);
+        gate.open();
+        bench::waitFor(done, tasks);
+        reporter.add({ "memory_per_task", { { "capture_bytes", double(captureBytes) } },
+            { { "bytes_per_queued_task", bytes / double(tasks) } } });
+    }
+}
+
+// Busy-wait for the given duration, standing in for CPU-bound work
+void spin(const std::chrono::nanoseconds duration) {
+    const auto end = bench::Clock::now() + duration;
+    while (bench::Clock::now() < end) {
+    }
+}
+
+// Latency of High and Realtime probes while the queue is flooded with CPU-bound Lowest tasks
+void priorityIsolation(bench::Reporter& reporter) {
+    static constexpr auto FloodTaskTime = std::chrono::microseconds(10);
+    static constexpr auto ProbeInterval = std::chrono::microseconds(100);
+    const auto probes = reporter.size(1000);
+    for (const auto workers : workerCounts()) {
+        for (const size_t depth : { size_t{ 100 }, size_t{ 1000 }, size_t{ 10000 } }) {
+            for (const bool osPriority : { false, true }) {
+                // Declared before the pool: flood tasks still queued run during its destruction
+                std::atomic_bool flooding{ true };
+                std::function<void()> flood;
+                PriorityThreadPool pool(workers);
+                pool.setOsPriorityEnabled(osPriority);
+
+                // Every flood task re-submits itself while flooding, keeping the queue depth constant
+                flood = [&pool, &flooding, &flood] {
+                    spin(FloodTaskTime);
+                    if (flooding.load(std::memory_order_relaxed)) {
+                        pool.add(flood, Priority::Lowest);
+                    }
+                };
+                std::vector<TaskPriority> backlog(depth, { flood, Priority::Lowest });
+                pool.add(backlog);
+
+                std::vector<double> startLatency[2], completionLatency[2];
+                for (auto i = 0; i < 2; ++i) {
+                    startLatency[i].resize(probes / 2);
+                    completionLatency[i].resize(probes / 2);
+                }
+                std::atomic_uint64_t done{ 0 };
+                auto next = bench::Clock::now();
+                for (uint64_t i = 0; i < probes / 2 * 2; ++i) {
+                    next += ProbeInterval;
+                    std::this_thread::sleep_until(next);
+                    const auto kind = i % 2;   // 0 for High, 1 for Realtime
+                    const auto submitted = bench::Clock::now();
+                    pool.add([&, submitted, kind, slot = i / 2] {
+                        startLatency[kind][slot] = bench::nanosecondsSince(submitted);
+                        spin(std::chrono::microseconds(1));
+                        completionLatency[kind][slot] = bench::nanosecondsSince(submitted);
+                        done.fetch_add(1, std::memory_order_release);
+                    }, kind == 0 ? Priority::High : Priority::Realtime);
+                }
+                bench::waitFor(done, probes / 2 * 2);
+                flooding = false;
+
+                for (auto kind = 0; kind < 2; ++kind) {
+                    reporter.add(bench::Result{ "priority_isolation", { { "workers", double(workers) },
+                        { "queue_depth", double(depth) }, { "os_priority", double(osPriority) },
+                        { "probe_priority", double(priorityIndex(kind == 0 ? Priority::High : Priority::Realtime)) } }, {} }
+                        .latency("submit_to_start", bench::percentiles(startLatency[kind]))
+                        .latency("submit_to_completion", bench::percentiles(completionLatency[kind])));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Reporter reporter(argc, argv);
+    const std::pair<const char*, void (*)(bench::Reporter&)> scenarios[] = {
+        { "throughput", throughput },
+        { "dispatch_latency", dispatchLatency },
+        { "realtime_spin", realtimeSpin },
+        { "bulk_add", bulkAdd },
+        { "priority_flip", priorityFlip },
+        { "memory_per_task", memoryPerTask },
+        { "priority_isolation", priorityIsolation },
+    };
+    for (const auto& [name, scenario] : scenarios) {
+        if (reporter.selected(name)) {
+            scenario(reporter);
+        }
+    }
+    return 0;
+}
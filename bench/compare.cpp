@@ -0,0 +1,179 @@
+// Runs identical workloads against PriorityThreadPool and the reference pools in
+// baseline_pools.h, printing throughput and tail latency tables.
+//
+// Build: g++ -std=c++20 -O2 -DNDEBUG compare.cpp -o compare -pthread
+// Run:   ./compare [--quick] [--json results.json] [--filter workload]
+#include <map>
+#include "bench_util.h"
+#include "baseline_pools.h"
+
+namespace {
+
+const auto Workers = static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()));
+
+// Measurements of one workload on one pool
+struct Measurement {
+    uint64_t            tasks{ 0 };
+    double              elapsed{ 0 };      // Nanoseconds from the first submission to the last completion
+    std::vector<double> latencies;         // Submit-to-start latency of every task
+    std::vector<double> urgentLatencies;   // Submit-to-start latency of High and Realtime tasks only
+};
+
+// Busy-wait for the given duration, standing in for CPU-bound work
+void spin(const std::chrono::nanoseconds duration) {
+    const auto end = bench::Clock::now() + duration;
+    while (bench::Clock::now() < end) {
+    }
+}
+
+// One producer submits many empty tasks
+template<typename Pool>
+Measurement fineGrained(const uint64_t tasks) {
+    Measurement measurement{ tasks, 0, std::vector<double>(tasks), {} };
+    std::atomic_uint64_t done{ 0 };
+    const auto start = bench::Clock::now();
+    {
+        Pool pool(Workers);
+        for (uint64_t i = 0; i < tasks; ++i) {
+            pool.add([&, i, submitted = bench::Clock::now()] {
+                measurement.latencies[i] = bench::nanosecondsSince(submitted);
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+        bench::waitFor(done, tasks);
+        measurement.elapsed = bench::nanosecondsSince(start);
+    }
+    return measurement;
+}
+
+// One task submits all the others
+template<typename Pool>
+Measurement fanOut(const uint64_t tasks) {
+    Measurement measurement{ tasks, 0, std::vector<double>(tasks), {} };
+    std::atomic_uint64_t done{ 0 };
+    const auto start = bench::Clock::now();
+    {
+        Pool pool(Workers);
+        pool.add([&] {
+            for (uint64_t i = 0; i < tasks; ++i) {
+                pool.add([&, i, submitted = bench::Clock::now()] {
+                    measurement.latencies[i] = bench::nanosecondsSince(submitted);
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        });
+        bench::waitFor(done, tasks);
+        measurement.elapsed = bench::nanosecondsSince(start);
+    }
+    return measurement;
+}
+
+// Short CPU-bound tasks with random priorities
+template<typename Pool>
+Measurement mixedPriorities(const uint64_t tasks) {
+    Measurement measurement{ tasks, 0, std::vector<double>(tasks), {} };
+    std::vector<Priority> priorities(tasks);
+    std::minstd_rand random(42);
+    for (auto& priority : priorities) {
+        priority = Priorities[random() % std::size(Priorities)];
+    }
+    std::atomic_uint64_t done{ 0 };
+    const auto start = bench::Clock::now();
+    {
+        Pool pool(Workers);
+        for (uint64_t i = 0; i < tasks; ++i) {
+            pool.add([&, i, submitted = bench::Clock::now()] {
+                measurement.latencies[i] = bench::nanosecondsSince(submitted);
+                spin(std::chrono::microseconds(2));
+                done.fetch_add(1, std::memory_order_release);
+            }, priorities[i]);
+        }
+        bench::waitFor(done, tasks);
+        measurement.elapsed = bench::nanosecondsSince(start);
+    }
+    for (uint64_t i = 0; i < tasks; ++i) {
+        if (priorities[i] == Priority::High || priorities[i] == Priority::Realtime) {
+            measurement.urgentLatencies.push_back(measurement.latencies[i]);
+        }
+    }
+    return measurement;
+}
+
+// Every task submits a fixed number of children until the tree reaches the requested size
+template<typename Pool>
+Measurement nested(const uint64_t tasks) {
+    static constexpr uint64_t Branching = 4;
+    Measurement measurement{ tasks, 0, std::vector<double>(tasks), {} };
+    std::atomic_uint64_t done{ 0 };
+    const auto start = bench::Clock::now();
+    {
+        Pool pool(Workers);
+        // Task i submits tasks i * Branching + 1 ... i * Branching + Branching, like a binary heap layout
+        std::function<void(uint64_t)> submit = [&](const uint64_t i) {
+            pool.add([&, i, submitted = bench::Clock::now()] {
+                measurement.latencies[i] = bench::nanosecondsSince(submitted);
+                for (auto child = i * Branching + 1; child <= i * Branching + Branching && child < tasks; ++child) {
+                    submit(child);
+                }
+                done.fetch_add(1, std::memory_order_release);
+            });
+        };
+        submit(0);
+        bench::waitFor(done, tasks);
+        measurement.elapsed = bench::nanosecondsSince(start);
+    }
+    return measurement;
+}
+
+// Run one workload on every pool and print a table
+template<template<typename> typename Workload>
+void compare(bench::Reporter& reporter, const std::string& workload, const uint64_t tasks) {
+    std::cout << "\n" << workload << " (" << tasks << " tasks, " << Workers << " workers)\n"
+              << std::left << std::setw(22) << "pool" << std::right << std::setw(14) << "tasks/s"
+              << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us"
+              << std::setw(16) << "urgent p99 us" << "\n";
+
+    const auto run = [&](const std::string& name, Measurement measurement) {
+        const auto latency = bench::percentiles(measurement.latencies);
+        const auto urgent = bench::percentiles(measurement.urgentLatencies);
+        const auto throughput = double(measurement.tasks) * 1e9 / measurement.elapsed;
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << throughput << std::setprecision(1)
+                  << std::setw(12) << latency.p50 / 1000 << std::setw(12) << latency.p99 / 1000
+                  << std::setw(12) << latency.p999 / 1000 << std::setw(16) << urgent.p99 / 1000
+                  << std::defaultfloat << "\n";
+        reporter.add(bench::Result{ workload + "/" + name, { { "tasks", double(measurement.tasks) }, { "workers", double(Workers) } },
+            { { "tasks_per_second", throughput } } }.latency("submit_to_start", latency).latency("urgent_submit_to_start", urgent));
+    };
+
+    run("priority_thread_pool", Workload<PriorityThreadPool>()(tasks));
+    run("fifo_pool", Workload<bench::FifoPool>()(tasks));
+    run("work_stealing_pool", Workload<bench::WorkStealingPool>()(tasks));
+    run("thread_per_task", Workload<bench::ThreadPerTask>()(std::max<uint64_t>(1, tasks / 100)));  // Far slower per task
+}
+
+// Adapters so workloads can be passed as template template arguments
+template<typename Pool> struct FineGrained { Measurement operator()(uint64_t tasks) { return fineGrained<Pool>(tasks); } };
+template<typename Pool> struct FanOut { Measurement operator()(uint64_t tasks) { return fanOut<Pool>(tasks); } };
+template<typename Pool> struct MixedPriorities { Measurement operator()(uint64_t tasks) { return mixedPriorities<Pool>(tasks); } };
+template<typename Pool> struct Nested { Measurement operator()(uint64_t tasks) { return nested<Pool>(tasks); } };
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Reporter reporter(argc, argv);
+    reporter.quiet();
+    if (reporter.selected("fine_grained")) {
+        compare<FineGrained>(reporter, "fine_grained", reporter.size(500000));
+    }
+    if (reporter.selected("fan_out")) {
+        compare<FanOut>(reporter, "fan_out", reporter.size(500000));
+    }
+    if (reporter.selected("mixed_priorities")) {
+        compare<MixedPriorities>(reporter, "mixed_priorities", reporter.size(100000));
+    }
+    if (reporter.selected("nested")) {
+        compare<Nested>(reporter, "nested", reporter.size(500000));
+    }
+    return 0;
+}
@@ -4,27 +4,75 @@
  *****************************RUN AS ADMIN*******************************
  ************************************************************************/
 #include <span>                // For representing a view over a contiguous sequence
-#include <queue>               // For priority queue data structure
+#include <deque>               // For reads waiting on a full ring
+#include <array>               // For per-priority settings
+#include <bit>                 // For std::bit_width and std::countr_zero
 #include <atomic>              // For atomic types
+#include <chrono>              // For trace timestamps
+#include <memory>              // For std::unique_ptr
+#include <memory_resource>     // For polymorphic allocators
+#include <optional>            // For optional per-call settings and hand-off slots
+#include <semaphore>           // For parking idle workers
+#include <new>                 // For placement new
+#include <mutex>               // For synchronization
 #include <thread>              // For managing threads
+#include <string>              // For file paths
 #include <iostream>            // For standard input/output operations
+#include <algorithm>           // For std::for_each and std::sort
+#include <stdexcept>           // For std::invalid_argument and std::length_error
 #include <functional>          // For std::function
 #include <syncstream>          // For synchronized output stream
 #include <string_view>         // For string_view
-#include <shared_mutex>        // For synchronization
+#include <unordered_map>       // For per call site accounting
+#include <source_location>     // For call site capture
 #include <condition_variable>  // For condition_variable
+#include <coroutine>           // For awaitable reads
+#include <cerrno>              // For error codes of reads
 
 #ifdef __linux__ // These values are suggestives and you can change them!
 #   include <pthread.h>
+#   include <fcntl.h>         // For open
+#   include <unistd.h>        // For ftruncate and close
+#   include <sys/mman.h>      // For mmap
+#   include <time.h>          // For CLOCK_THREAD_CPUTIME_ID
+#   include <ucontext.h>      // For fiber context switches
+#   include <sys/syscall.h>   // For the io_uring system calls
+#   include <sys/epoll.h>     // For the descriptor reactor
+#   include <sys/eventfd.h>   // For waking the reactor leader
+#   if __has_include(<linux/io_uring.h>)
+#       include <linux/io_uring.h>
+#       define PRIORITY_THREAD_POOL_IO_URING
+#   endif
 #   define THREAD_PRIORITY_LOWEST          99
 #   define THREAD_PRIORITY_BELOW_NORMAL    75
 #   define THREAD_PRIORITY_NORMAL          50
 #   define THREAD_PRIORITY_ABOVE_NORMAL    25
 #   define THREAD_PRIORITY_HIGHEST         1
-#   define COMPARATOR                      >
 #else
 #   include <Windows.h>
-#   define COMPARATOR                      <
+#   include <io.h>            // For _get_osfhandle
+#endif
+
+// USDT probes for bpftrace/perf, compiled in only when PRIORITY_THREAD_POOL_USDT is defined.
+// A probe that is not attached costs a single nop; see the README for the probe list.
+#if defined(PRIORITY_THREAD_POOL_USDT) && defined(__linux__) && __has_include(<sys/sdt.h>)
+#   include <sys/sdt.h>
+#   define PRIORITY_THREAD_POOL_PROBE(name, ...) STAP_PROBEV(priority_thread_pool, name, __VA_ARGS__)
+#else
+#   define PRIORITY_THREAD_POOL_PROBE(name, ...) static_cast<void>(0)
+#endif
+
+// Schedule fuzzing hook run at the pool's lock and worker parking points. Stress tests define
+// it before including this header to inject yields and delays (see tools/stress.cpp).
+#ifndef PRIORITY_THREAD_POOL_FUZZ_POINT
+#   define PRIORITY_THREAD_POOL_FUZZ_POINT() static_cast<void>(0)
+#endif
+
+// Keeps a function out of line, so a fiber that moved to another thread re-reads thread-local state
+#ifdef _MSC_VER
+#   define PRIORITY_THREAD_POOL_NOINLINE __declspec(noinline)
+#else
+#   define PRIORITY_THREAD_POOL_NOINLINE __attribute__((noinline))
 #endif
 
  // Enumeration definition
@@ -62,137 +110,3058 @@ std::ostream& operator<<(std::ostream& os, Priority priority) {
 }
 
 
+// Cache line size assumed when separating state written by different threads
+inline constexpr size_t CacheLineSize = 64;
+
+// Number of distinct priority levels
+inline constexpr size_t PriorityLevels = 5;
+
+// Dense index of a priority, from 0 for Lowest to PriorityLevels - 1 for Realtime
+[[nodiscard]] constexpr size_t priorityIndex(const Priority priority) {
+    switch (priority) {
+    case Priority::Lowest:   return 0;
+    case Priority::Low:      return 1;
+    case Priority::High:     return 3;
+    case Priority::Realtime: return 4;
+    default:                 return 2;
+    }
+}
+
+// Priorities in priorityIndex() order
+inline constexpr std::array<Priority, PriorityLevels> Priorities{
+    Priority::Lowest, Priority::Low, Priority::Normal, Priority::High, Priority::Realtime };
+
 using Task = std::function<void()>;                // Alias for a callable object representing a task
 using TaskPriority = std::pair<Task, Priority>;    // Alias for a pair representing a task with its priority
 
-// Comparator for task priorities used in priority queue
-struct TaskPriorityComparator {
-    [[nodiscard]] bool operator()(const TaskPriority& first, const TaskPriority& second) const {
-        return first.second COMPARATOR second.second;
+// Task waiting in the pool's queue together with its bookkeeping
+struct QueuedTask {
+    Task     task;        // Callable to execute
+    Priority priority;    // Priority the task was submitted with
+    uint64_t id;          // Submission sequence number, used to correlate trace events
+    const char* tag;      // Optional caller supplied name with static storage duration
+    std::source_location location;    // Call site of add()
+    uint64_t enqueuedAt;  // Enqueue time in pool nanoseconds while accounting or admission control run, 0 otherwise
+    // Frees what the task owns once it ran or was dropped, may be null. An onDropped or onEvicted
+    // handler only borrows the task: it is released when the handler returns, so the handler may
+    // keep or re-submit a copy of `task` only if this is null, as it is for tasks of add(Task).
+    void (*release)(const Task&){ nullptr };
+};
+
+// FIFO of the queued tasks of one priority level: a growable ring over polymorphic allocator storage
+class TaskRing {
+public:
+    explicit TaskRing(std::pmr::memory_resource* resource) : m_slots(resource) {}
+
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    // Oldest task; the ring must not be empty
+    [[nodiscard]] const QueuedTask& front() const noexcept { return m_slots[m_head]; }
+
+    void push(QueuedTask&& task) {
+        if (m_size == m_slots.size()) [[unlikely]] {
+            grow();
+        }
+        m_slots[(m_head + m_size) & (m_slots.size() - 1)] = std::move(task);
+        ++m_size;
+    }
+
+    // Remove and return the oldest task; the ring must not be empty
+    QueuedTask take() noexcept {
+        auto task = std::move(m_slots[m_head]);
+        m_slots[m_head].task = nullptr;    // Release the callable's captures now, not when the slot is reused
+        m_head = (m_head + 1) & (m_slots.size() - 1);
+        --m_size;
+        return task;
+    }
+
+    // Task at the given age, 0 being the oldest; it must be queued
+    [[nodiscard]] const QueuedTask& operator[](const size_t index) const noexcept {
+        return m_slots[(m_head + index) & (m_slots.size() - 1)];
+    }
+
+    // Remove and return the task at the given age, keeping the others in order; it must be queued
+    QueuedTask take(const size_t index) noexcept {
+        const auto mask = m_slots.size() - 1;
+        auto task = std::move(m_slots[(m_head + index) & mask]);
+        if (index < m_size / 2) {    // Close the gap from the shorter side
+            for (auto i = index; i > 0; --i) {
+                m_slots[(m_head + i) & mask] = std::move(m_slots[(m_head + i - 1) & mask]);
+            }
+            m_slots[m_head].task = nullptr;
+            m_head = (m_head + 1) & mask;
+        } else {
+            for (auto i = index + 1; i < m_size; ++i) {
+                m_slots[(m_head + i - 1) & mask] = std::move(m_slots[(m_head + i) & mask]);
+            }
+            m_slots[(m_head + m_size - 1) & mask].task = nullptr;
+        }
+        --m_size;
+        return task;
+    }
+
+private:
+    // Double the capacity, keeping it a power of two, and unwrap the tasks to the front
+    void grow() {
+        std::pmr::vector<QueuedTask> slots(std::max<size_t>(m_slots.size() * 2, 16), m_slots.get_allocator());
+        for (size_t i = 0; i < m_size; ++i) {
+            slots[i] = std::move(m_slots[(m_head + i) & (m_slots.size() - 1)]);
+        }
+        m_slots = std::move(slots);
+        m_head = 0;
     }
+
+    std::pmr::vector<QueuedTask> m_slots;        // Ring storage, empty or a power of two in size
+    size_t                       m_head{ 0 };    // Slot of the oldest task
+    size_t                       m_size{ 0 };    // Number of queued tasks
 };
 
-// Alias for a priority queue of tasks based on priority
-using TasksPriorityQueue = std::priority_queue<TaskPriority, std::vector<TaskPriority>, TaskPriorityComparator>;
+// Tasks waiting in the pool, one FIFO per priority level. top() is the oldest task of the highest
+// non-empty level, found with a bit scan over the level mask, so every operation is O(1) and tasks
+// of the same priority run in submission order. Also used by tools/scheduling_simulator.cpp.
+class TasksPriorityQueue {
+public:
+    static_assert(PriorityLevels == 5, "one ring per priority level");
 
-class PriorityThreadPool {
+    explicit TasksPriorityQueue(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_levels{ TaskRing(resource), TaskRing(resource), TaskRing(resource), TaskRing(resource), TaskRing(resource) } {}
+
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    // Number of queued tasks of one priority
+    [[nodiscard]] size_t size(const Priority priority) const noexcept {
+        return m_levels[priorityIndex(priority)].size();
+    }
+
+    // Bit per non-empty level, bit i set for priorityIndex() i. May be read without the lock that
+    // guards the queue, as a hint to confirm under the lock.
+    [[nodiscard]] unsigned levels() const noexcept { return m_mask.load(std::memory_order_relaxed); }
+
+    // Highest priority, oldest task; the queue must not be empty
+    [[nodiscard]] const QueuedTask& top() const noexcept {
+        return m_levels[topLevel()].front();
+    }
+
+    // Oldest task of one priority; that level must not be empty
+    [[nodiscard]] const QueuedTask& front(const Priority priority) const noexcept {
+        return m_levels[priorityIndex(priority)].front();
+    }
+
+    void push(QueuedTask task) {
+        const auto level = priorityIndex(task.priority);
+        m_levels[level].push(std::move(task));
+        m_mask.store(m_mask.load(std::memory_order_relaxed) | 1u << level, std::memory_order_relaxed);
+        ++m_size;
+    }
+
+    void pop() noexcept {
+        static_cast<void>(take());
+    }
+
+    // Remove and return the top task; the queue must not be empty
+    [[nodiscard]] QueuedTask take() noexcept {
+        return take(topLevel());
+    }
+
+    // Remove and return the oldest task of one priority; that level must not be empty
+    [[nodiscard]] QueuedTask take(const Priority priority) noexcept {
+        return take(priorityIndex(priority));
+    }
+
+    // Remove and return the oldest task of the level with the given priorityIndex(); it must not be empty
+    [[nodiscard]] QueuedTask take(const size_t level) noexcept {
+        auto& ring = m_levels[level];
+        auto task = ring.take();
+        if (ring.empty()) {
+            m_mask.store(m_mask.load(std::memory_order_relaxed) & ~(1u << level), std::memory_order_relaxed);
+        }
+        --m_size;
+        return task;
+    }
+
+    // Remove and return the oldest task of one priority that `removable` accepts, if there is one
+    template<typename Predicate>
+    [[nodiscard]] std::optional<QueuedTask> takeOldest(const Priority priority, Predicate&& removable) {
+        const auto level = priorityIndex(priority);
+        const auto& ring = m_levels[level];
+        for (size_t i = 0; i < ring.size(); ++i) {
+            if (removable(ring[i])) {
+                return take(level, i);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Remove and return the newest task that `removable` accepts of the lowest level below the given
+    // priority holding one, if there is one
+    template<typename Predicate>
+    [[nodiscard]] std::optional<QueuedTask> takeLowest(const Priority below, Predicate&& removable) {
+        for (auto mask = levels() & ((1u << priorityIndex(below)) - 1); mask != 0; mask &= mask - 1) {
+            const auto level = static_cast<size_t>(std::countr_zero(mask));
+            const auto& ring = m_levels[level];
+            for (auto i = ring.size(); i-- > 0;) {
+                if (removable(ring[i])) {
+                    return take(level, i);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    // Remove and return the task at the given age of a level
+    [[nodiscard]] QueuedTask take(const size_t level, const size_t index) noexcept {
+        auto& ring = m_levels[level];
+        auto task = ring.take(index);
+        if (ring.empty()) {
+            m_mask.store(m_mask.load(std::memory_order_relaxed) & ~(1u << level), std::memory_order_relaxed);
+        }
+        --m_size;
+        return task;
+    }
+
+    [[nodiscard]] size_t topLevel() const noexcept {
+        return static_cast<size_t>(std::bit_width(levels())) - 1;
+    }
+
+    std::array<TaskRing, PriorityLevels> m_levels;    // Queued tasks by priorityIndex()
+    std::atomic<unsigned>                m_mask{ 0 };  // Bit per non-empty level, written by the lock holder only
+    size_t                               m_size{ 0 };  // Total number of queued tasks
+};
+
+// Task lifecycle events recorded while tracing is enabled
+enum class TraceEvent : uint8_t {
+    Enqueue,          // Task was added to the queue by a producer
+    Dequeue,          // Task was removed from the queue by a worker
+    Start,            // Worker started executing the task
+    End,              // Worker finished executing the task
+    PriorityChange    // Worker changed its OS thread priority before running the task
+};
+
+// Single trace event, also the binary record layout of flight recorder files
+struct TraceRecord {
+    uint64_t   timestamp;    // Nanoseconds since the pool was created
+    uint64_t   taskId;       // Submission sequence number of the task
+    uint32_t   worker;       // Worker index, or TraceRing::Producer for enqueue events
+    uint32_t   queueDepth;   // Queue size after enqueue or dequeue, 0 for other events
+    Priority   priority;     // Priority of the task
+    TraceEvent event;        // Kind of event
+};
+
+// Fixed-size ring buffer of trace records with a single writer
+class TraceRing {
 public:
-    // Deleted move and copy constructors and assignment operators
-    PriorityThreadPool(PriorityThreadPool&&) = delete;
-    PriorityThreadPool(const PriorityThreadPool&) = delete;
-    PriorityThreadPool& operator=(PriorityThreadPool&&) = delete;
-    PriorityThreadPool& operator=(const PriorityThreadPool&) = delete;
+    static constexpr uint32_t Producer = UINT32_MAX;    // Worker index used for producer events
 
-    // Constructor for PriorityThreadPool
-    explicit PriorityThreadPool(const size_t maxThreads = std::thread::hardware_concurrency()) {
-        if (maxThreads <= 0) {
-            throw std::invalid_argument("maxThreads must be greater than 0!");
+    // Allocate storage; must happen before tracing is first enabled
+    void allocate(const size_t capacity) {
+        m_records = std::make_unique<TraceRecord[]>(capacity);
+        m_capacity = capacity;
+    }
+
+    // Append a record, overwriting the oldest one when full
+    void push(const TraceRecord& record) noexcept {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        m_records[head % m_capacity] = record;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    // Visit the retained records from oldest to newest
+    template<typename Function>
+    void forEach(Function&& func) const {
+        const auto head = m_head.load(std::memory_order_acquire);
+        for (auto i = head > m_capacity ? head - m_capacity : 0; i < head; ++i) {
+            func(m_records[i % m_capacity]);
         }
+    }
+
+private:
+    std::unique_ptr<TraceRecord[]> m_records;       // Record storage
+    size_t                         m_capacity{ 0 }; // Number of records kept
+    std::atomic_uint64_t           m_head{ 0 };     // Total number of records written
+};
 
-        m_threads.reserve(maxThreads);  // Reserve space for threads in the vector
+// Write trace records in Chrome trace JSON format, one track per worker plus one for producers
+inline void writeChromeTraceRecords(std::ostream& os, std::vector<TraceRecord> records, const size_t workers) {
+    std::sort(records.begin(), records.end(), [](const auto& first, const auto& second) {
+        return first.timestamp < second.timestamp;
+    });
 
-        // Create threads and assign tasks to them
-        for (size_t i = 0; i < maxThreads; ++i) {
-            m_threads.push_back(std::jthread([this] {                
-                // Get thread ID only once
+    os << "{\"traceEvents\":[\n";
+    os << R"({"name":"thread_name","ph":"M","pid":0,"tid":0,"args":{"name":"Producers"}})";
+    for (size_t i = 0; i < workers; ++i) {
+        os << ",\n" << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << i + 1
+           << R"(,"args":{"name":"Worker )" << i << R"("}})";
+    }
+    for (const auto& record : records) {
+        static constexpr const char* names[] = { "Enqueue", "Dequeue", "Task", "Task", "PriorityChange" };
+        static constexpr const char* phases[] = { "i", "i", "B", "E", "i" };
+        const auto event = static_cast<size_t>(record.event);
+        const auto tid = record.worker == TraceRing::Producer ? 0 : static_cast<uint64_t>(record.worker) + 1;
+        os << ",\n{\"name\":\"" << names[event] << "\",\"ph\":\"" << phases[event]
+           << "\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << record.timestamp / 1000.0;
+        if (phases[event][0] == 'i') {
+            os << ",\"s\":\"t\"";     // Thread scoped instant event
+        }
+        os << ",\"args\":{\"task\":" << record.taskId << ",\"priority\":\"" << record.priority
+           << "\",\"queueDepth\":" << record.queueDepth << "}}";
+    }
+    os << "\n]}\n";
+}
+
+// Header of a flight recorder file, followed by `capacity` trace records
+struct FlightRecorderHeader {
+    static constexpr uint64_t Magic = 0x31524c4650545450;   // "PTTPFLR1"
+    static constexpr uint32_t Version = 1;
+
+    uint64_t             magic;          // Always Magic
+    uint32_t             version;        // File format version
+    uint32_t             recordSize;     // sizeof(TraceRecord) of the writer
+    uint64_t             capacity;       // Number of records in the ring
+    int64_t              epochUnixNs;    // Wall clock time of timestamp zero, in Unix nanoseconds
+    std::atomic_uint64_t head;           // Total number of records written
+};
+
+static_assert(std::atomic_uint64_t::is_always_lock_free, "Flight recorder requires a lock-free 64-bit atomic");
+
+// Always-on ring of scheduling events kept in a memory-mapped file, so it survives a crash or
+// can be copied out of a stalled process. Any thread may write; the file is decoded offline.
+class FlightRecorder {
+public:
+    FlightRecorder() = default;
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    ~FlightRecorder() {
 #ifdef __linux__
-                const auto threadId = pthread_self();
-                int policy;
-                sched_param param;
-#elif _WIN32
-                const auto threadId = GetCurrentThread();
-#endif
-                auto lastPriority = Priority::Normal;
-                while (true) {
-                    // Locking mutex for thread safety
-                    std::unique_lock lock(m_mutex);
-                    // Wait until notified or tasks available
-                    m_cv.wait(lock, [this] { return m_quit || !m_tasks.empty(); });
-                    if (m_tasks.empty()) [[unlikely]] {    // If tasks are empty                    
-                        if (m_quit) [[unlikely]] {         // Check if thread pool is quitting                        
-                            break;                         // Break the loop if quitting
-                        }
-                        continue;                          // Continue to wait for tasks if not quitting
-                    }
-                    const auto task = m_tasks.top();       // Get the top priority task
-                    m_tasks.pop();                         // Remove the task from the queue
-                    lock.unlock();                         // Unlock the mutex
+        if (const auto header = m_header.load(std::memory_order_relaxed)) {
+            munmap(header, m_mappedBytes);
+        }
+#endif
+    }
 
-                    if (lastPriority == task.second) [[likely]] { // If the task priority is the same as the last one
-                        task.first();
-                        continue;
-                    }
-                    
-                    // When the task is priority is different from the last one
-                    lastPriority = task.second;
-                    [[maybe_unused]] const auto priority = static_cast<int>(task.second); // Gets task priority
-                    [[maybe_unused]] static constexpr std::string_view errorMessage("Could not change thread priority!\n");
-#ifdef __linux__                    
-                    // Try to get thread sched parameters on Linux
-                    if (pthread_getschedparam(threadId, &policy, &param) == 0) [[likely]] {
-                        policy = SCHED_FIFO;
-                        param.sched_priority = priority;
-                        // Change the thread priority on Linux
-                        if (pthread_setschedparam(threadId, policy, &param) != 0) [[unlikely]] { // If fails    
-                            std::osyncstream(std::cerr) << errorMessage;
-                        }
-                    }
-#elif _WIN32
-                    // Change the thread priority on Windows
-                    if (!SetThreadPriority(threadId, priority)) [[unlikely]] {  // If fails                           
-                        std::osyncstream(std::cerr) << errorMessage;
-                    }
+    // Create and map the file; returns false if it is already open or mapping fails
+    bool open(const std::string& path, const size_t capacity, const int64_t epochUnixNs) {
+#ifdef __linux__
+        if (m_header.load(std::memory_order_relaxed) != nullptr || capacity == 0) {
+            return false;
+        }
+        const auto bytes = sizeof(FlightRecorderHeader) + capacity * sizeof(TraceRecord);
+        const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        void* memory = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);  // The mapping keeps the file alive
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        auto header = new (memory) FlightRecorderHeader{ FlightRecorderHeader::Magic, FlightRecorderHeader::Version,
+            sizeof(TraceRecord), capacity, epochUnixNs, {} };
+        m_records = reinterpret_cast<TraceRecord*>(header + 1);
+        m_capacity = capacity;
+        m_mappedBytes = bytes;
+        m_header.store(header, std::memory_order_release);
+        return true;
+#else
+        static_cast<void>(path);
+        static_cast<void>(capacity);
+        static_cast<void>(epochUnixNs);
+        return false;
 #endif
-                    task.first(); // Execute the task
+    }
+
+    // Whether the recorder is mapped and accepting records
+    [[nodiscard]] bool active() const noexcept {
+        return m_header.load(std::memory_order_acquire) != nullptr;
+    }
+
+    // Append a record; must only be called when active() returned true
+    void push(const TraceRecord& record) noexcept {
+        const auto index = m_header.load(std::memory_order_relaxed)->head.fetch_add(1, std::memory_order_relaxed);
+        m_records[index % m_capacity] = record;
+    }
+
+private:
+    std::atomic<FlightRecorderHeader*> m_header{ nullptr };    // Mapped file, null when inactive
+    TraceRecord*                       m_records{ nullptr };   // Record ring following the header
+    size_t                             m_capacity{ 0 };        // Number of records in the ring
+    size_t                             m_mappedBytes{ 0 };     // Size of the mapping
+};
+
+// Memory resource handing out memory from 2 MiB huge pages to cut dTLB misses when millions of
+// tasks are queued. Pages are mapped with MAP_HUGETLB when the system has reserved huge pages,
+// otherwise aligned regular mappings are advised with MADV_HUGEPAGE for transparent huge pages,
+// and plain pages are used if both fail. Small blocks are pooled; blocks of at least half a page
+// get mappings of their own, returned on deallocation. Thread-safe.
+class HugePageResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t PageSize = 2 << 20;    // Size of a huge page
+
+    // Blocks up to largestPooledBlock bytes are pooled; larger ones come from their own mappings
+    explicit HugePageResource(const size_t largestPooledBlock = 64 << 10)
+        : m_pool(std::pmr::pool_options{ 0, largestPooledBlock }, &m_pages) {
+        // The pool may adjust the option; larger blocks reach the pages directly and are freed one by one
+        m_pages.setLargestPooledBlock(m_pool.options().largest_required_pool_block);
+    }
+
+    // Bytes currently mapped from reserved huge pages (MAP_HUGETLB)
+    [[nodiscard]] uint64_t hugePageBytes() const noexcept {
+        return m_pages.bytes(Backing::HugeTlb);
+    }
+
+    // Bytes currently mapped with MADV_HUGEPAGE; the kernel backs them with huge pages when it can
+    [[nodiscard]] uint64_t transparentHugePageBytes() const noexcept {
+        return m_pages.bytes(Backing::Transparent);
+    }
+
+    // Bytes currently mapped from regular pages after both huge page methods failed
+    [[nodiscard]] uint64_t fallbackBytes() const noexcept {
+        return m_pages.bytes(Backing::Regular);
+    }
+
+private:
+    enum Backing { HugeTlb, Transparent, Regular, BackingCount };
+
+    // Upstream of the block pool: bump-allocates the pool's small chunks from huge page chunks that
+    // are kept until destruction, and gives everything larger than a pooled block a mapping of its own
+    class Pages : public std::pmr::memory_resource {
+    public:
+        Pages() = default;
+        Pages(const Pages&) = delete;
+        Pages& operator=(const Pages&) = delete;
+
+        ~Pages() override {
+            for (const auto& chunk : m_chunks) {
+                unmap(chunk.memory, PageSize);
+            }
+        }
+
+        [[nodiscard]] uint64_t bytes(const Backing backing) const noexcept {
+            return m_bytes[backing].load(std::memory_order_relaxed);
+        }
+
+        // Set the pool's largest block size, before the first allocation
+        void setLargestPooledBlock(const size_t bytes) noexcept {
+            m_largestPooledBlock = bytes;
+        }
+
+    private:
+        struct Mapping {
+            void*   memory;
+            Backing backing;
+        };
+
+        void* do_allocate(const size_t bytes, const size_t alignment) override {
+            if (alignment > PageSize) {
+                throw std::bad_alloc();
+            }
+            std::lock_guard guard(m_mutex);
+            if (large(bytes)) {
+                const auto size = roundUp(bytes);
+                const auto mapping = map(size);
+                try {
+                    m_large.emplace(mapping.memory, mapping.backing);
+                } catch (...) {
+                    release(mapping, size);
+                    throw;
                 }
-            }));
+                return mapping.memory;
+            }
+            auto offset = (m_used + alignment - 1) & ~(alignment - 1);
+            if (m_chunks.empty() || offset + bytes > PageSize) {
+                m_chunks.reserve(m_chunks.size() + 1);    // Keep the new chunk if this throws
+                m_chunks.push_back(map(PageSize));
+                offset = 0;
+            }
+            m_used = offset + bytes;
+            return static_cast<std::byte*>(m_chunks.back().memory) + offset;
+        }
+
+        void do_deallocate(void* memory, const size_t bytes, size_t) override {
+            if (!large(bytes)) {
+                return;    // Only the pool's own chunks are bump-allocated, and it frees them on destruction
+            }
+            std::lock_guard guard(m_mutex);
+            const auto it = m_large.find(memory);
+            release({ memory, it->second }, roundUp(bytes));
+            m_large.erase(it);
+        }
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        // Whether a request gets a mapping of its own: blocks the pool does not recycle, which it
+        // frees one by one, and chunks too large to share a huge page
+        [[nodiscard]] bool large(const size_t bytes) const noexcept {
+            return bytes > m_largestPooledBlock || bytes >= PageSize / 2;
+        }
+
+        [[nodiscard]] static size_t roundUp(const size_t bytes) noexcept {
+            return (bytes + PageSize - 1) & ~(PageSize - 1);
+        }
+
+        // Map size bytes, a multiple of PageSize, aligned to PageSize
+        Mapping map(const size_t size) {
+#ifdef __linux__
+            auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory != MAP_FAILED) [[likely]] {
+                m_bytes[HugeTlb].fetch_add(size, std::memory_order_relaxed);
+                return { memory, HugeTlb };
+            }
+            // Over-allocate by one page and trim both ends so the range is huge page aligned
+            memory = mmap(nullptr, size + PageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            const auto address = reinterpret_cast<uintptr_t>(memory);
+            const auto aligned = (address + PageSize - 1) & ~(PageSize - 1);
+            if (aligned != address) {
+                munmap(memory, aligned - address);
+            }
+            if (const auto tail = address + PageSize - aligned; tail != 0) {
+                munmap(reinterpret_cast<void*>(aligned + size), tail);
+            }
+            memory = reinterpret_cast<void*>(aligned);
+            const auto backing = madvise(memory, size, MADV_HUGEPAGE) == 0 ? Transparent : Regular;
+            m_bytes[backing].fetch_add(size, std::memory_order_relaxed);
+            return { memory, backing };
+#else
+            const auto memory = ::operator new(size, std::align_val_t(PageSize));
+            m_bytes[Regular].fetch_add(size, std::memory_order_relaxed);
+            return { memory, Regular };
+#endif
+        }
+
+        void release(const Mapping& mapping, const size_t size) noexcept {
+            unmap(mapping.memory, size);
+            m_bytes[mapping.backing].fetch_sub(size, std::memory_order_relaxed);
+        }
+
+        static void unmap(void* memory, const size_t size) noexcept {
+#ifdef __linux__
+            munmap(memory, size);
+#else
+            ::operator delete(memory, size, std::align_val_t(PageSize));
+#endif
         }
+
+        std::mutex                                   m_mutex;        // Guards the chunks and large mappings
+        std::vector<Mapping>                         m_chunks;       // Chunks small requests are carved from
+        size_t                                       m_used{ 0 };    // Bytes used in the last chunk
+        size_t                                       m_largestPooledBlock{ 0 };    // Largest block the pool recycles
+        std::unordered_map<void*, Backing>           m_large;        // Mappings of large requests
+        std::array<std::atomic_uint64_t, BackingCount> m_bytes{};    // Mapped bytes per backing
+    };
+
+    void* do_allocate(const size_t bytes, const size_t alignment) override {
+        return m_pool.allocate(bytes, alignment);
     }
 
-    // Destructor for PriorityThreadPool
-    ~PriorityThreadPool() {
-        m_quit = true;       // Set quit flag to true
-        m_cv.notify_all();   // Notify all threads to wake up
+    void do_deallocate(void* memory, const size_t bytes, const size_t alignment) override {
+        m_pool.deallocate(memory, bytes, alignment);
     }
 
-    // Add a task to the thread pool with specified priority
-    void add(const Task task, const Priority priority = Priority::Normal) {
-        {
-            // Lock mutex for thread safety
-            std::lock_guard guard(m_mutex);
-            // Add task to the queue
-            m_tasks.emplace(std::make_pair(task, priority));
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    Pages                                 m_pages;    // Huge page mappings, destroyed after the pool
+    std::pmr::synchronized_pool_resource  m_pool;     // Recycles blocks carved from the mappings
+};
+
+// Minimal io_uring instance driven by raw system calls, so no liburing is needed. Submissions
+// must be serialized by the caller, and a single thread reaps completions.
+class IoUring {
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        close();
+    }
+
+    // Create the ring; returns false if it is open already, the kernel refuses (e.g. under seccomp)
+    // or the platform is not Linux
+    bool open(const unsigned entries) {
+#ifdef PRIORITY_THREAD_POOL_IO_URING
+        if (m_fd >= 0) {
+            return false;
+        }
+        io_uring_params params{};
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0) {
+            return false;
+        }
+        m_sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const auto single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            m_sqBytes = m_cqBytes = std::max(m_sqBytes, m_cqBytes);
         }
-        m_cv.notify_one();
+        m_sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        m_sq = mmap(nullptr, m_sqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        m_cq = single ? m_sq
+                      : mmap(nullptr, m_cqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        m_sqes = mmap(nullptr, m_sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (m_sq == MAP_FAILED || m_cq == MAP_FAILED || m_sqes == MAP_FAILED) {
+            close();
+            return false;
+        }
+        const auto sq = static_cast<char*>(m_sq);
+        const auto cq = static_cast<char*>(m_cq);
+        m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        m_entries = params.sq_entries;
+        return true;
+#else
+        static_cast<void>(entries);
+        return false;
+#endif
     }
 
-    // Add multiple tasks to the thread pool
-    void add(std::span<TaskPriority> tasks) {
-        {
-            // Lock mutex for thread safety
-            std::lock_guard guard(m_mutex);
-            // Add each task to the queue
-            std::for_each(std::begin(tasks), std::end(tasks), [this](const auto& task) { m_tasks.push(task); });
+    // Unmap and close the ring; no request may be in flight
+    void close() {
+#ifdef PRIORITY_THREAD_POOL_IO_URING
+        if (m_fd < 0) {
+            return;
+        }
+        if (m_sqes != MAP_FAILED) {
+            munmap(m_sqes, m_sqesBytes);
+        }
+        if (m_cq != MAP_FAILED && m_cq != m_sq) {
+            munmap(m_cq, m_cqBytes);
         }
-        m_cv.notify_one();
+        if (m_sq != MAP_FAILED) {
+            munmap(m_sq, m_sqBytes);
+        }
+        m_sq = m_cq = m_sqes = MAP_FAILED;
+        ::close(m_fd);
+        m_fd = -1;
+#endif
     }
 
-    // Get the number of remaining tasks in the queue
-    [[nodiscard]] size_t remainingTasks() const {
-        std::shared_lock guard(m_mutex);   // Lock mutex for read
-        return m_tasks.size();             // Return the size of the queue
+    // Number of submission queue entries, 0 when closed
+    [[nodiscard]] unsigned entries() const noexcept {
+        return m_fd >= 0 ? m_entries : 0;
     }
 
-    // Check if there are remaining tasks in the queue
-    [[nodiscard]] bool hasRemainingTasks() const {
-        std::shared_lock guard(m_mutex);    // Lock mutex for read
-        return !m_tasks.empty();            // Return true if queue is not empty
+    // Submit a read of up to `bytes` bytes at `offset`; returns false if the kernel did not take it
+    bool read(const int fd, void* buffer, const unsigned bytes, const uint64_t offset, const uint64_t userData) {
+#ifdef PRIORITY_THREAD_POOL_IO_URING
+        return submit(IORING_OP_READ, fd, buffer, bytes, offset, userData);
+#else
+        static_cast<void>(fd);
+        static_cast<void>(buffer);
+        static_cast<void>(bytes);
+        static_cast<void>(offset);
+        static_cast<void>(userData);
+        return false;
+#endif
+    }
+
+    // Submit a request that completes immediately, e.g. to wake the reaping thread
+    bool nop(const uint64_t userData) {
+#ifdef PRIORITY_THREAD_POOL_IO_URING
+        return submit(IORING_OP_NOP, -1, nullptr, 0, 0, userData);
+#else
+        static_cast<void>(userData);
+        return false;
+#endif
+    }
+
+    // Wait for at least one completion, then pass every available one to onCompletion(userData, result)
+    template<typename OnCompletion>
+    void reap(OnCompletion&& onCompletion) {
+#ifdef PRIORITY_THREAD_POOL_IO_URING
+        syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);  // EINTR just reaps nothing
+        auto head = *m_cqHead;    // Only written by this thread
+        const auto tail = std::atomic_ref(*m_cqTail).load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const auto& completion = m_cqes[head & m_cqMask];
+            onCompletion(static_cast<uint64_t>(completion.user_data), static_cast<int64_t>(completion.res));
+        }
+        std::atomic_ref(*m_cqHead).store(head, std::memory_order_release);
+#else
+        static_cast<void>(onCompletion);
+#endif
     }
 
 private:
-    std::atomic_bool            m_quit{ false };  // Atomic boolean flag for indicating quitting
-    TasksPriorityQueue          m_tasks;          // Priority queue for tasks
-    std::vector<std::jthread>   m_threads;        // Vector to hold worker threads
-    std::condition_variable_any m_cv;             // Condition variable for synchronization
-    mutable std::shared_mutex   m_mutex;          // Mutex for thread safety
+#ifdef PRIORITY_THREAD_POOL_IO_URING
+    // Fill the next submission queue entry and hand it to the kernel
+    bool submit(const uint8_t opcode, const int fd, void* buffer, const unsigned bytes, const uint64_t offset,
+                const uint64_t userData) {
+        const auto tail = *m_sqTail;    // Only written by the serialized submitters
+        if (tail - std::atomic_ref(*m_sqHead).load(std::memory_order_acquire) >= m_entries) {
+            return false;
+        }
+        const auto index = tail & m_sqMask;
+        auto& entry = static_cast<io_uring_sqe*>(m_sqes)[index];
+        entry = {};
+        entry.opcode = opcode;
+        entry.fd = fd;
+        entry.addr = reinterpret_cast<uint64_t>(buffer);
+        entry.len = bytes;
+        entry.off = offset;
+        entry.user_data = userData;
+        m_sqArray[index] = index;
+        std::atomic_ref(*m_sqTail).store(tail + 1, std::memory_order_release);
+        if (syscall(__NR_io_uring_enter, m_fd, 1, 0, 0, nullptr, 0) == 1) [[likely]] {
+            return true;
+        }
+        // Without SQPOLL the kernel only reads the queue during io_uring_enter, so the entry can be taken back
+        std::atomic_ref(*m_sqTail).store(tail, std::memory_order_release);
+        return false;
+    }
+
+    void*         m_sq{ MAP_FAILED };      // Submission queue ring
+    void*         m_cq{ MAP_FAILED };      // Completion queue ring, may share the submission queue's mapping
+    void*         m_sqes{ MAP_FAILED };    // Submission queue entries
+    size_t        m_sqBytes{ 0 };
+    size_t        m_cqBytes{ 0 };
+    size_t        m_sqesBytes{ 0 };
+    unsigned*     m_sqHead{ nullptr };
+    unsigned*     m_sqTail{ nullptr };
+    unsigned*     m_sqArray{ nullptr };
+    unsigned      m_sqMask{ 0 };
+    unsigned*     m_cqHead{ nullptr };
+    unsigned*     m_cqTail{ nullptr };
+    unsigned      m_cqMask{ 0 };
+    io_uring_cqe* m_cqes{ nullptr };
+#endif
+    int           m_fd{ -1 };              // Ring file descriptor, -1 when closed
+    unsigned      m_entries{ 0 };          // Submission queue size
+};
+
+// Task that exceeded its watchdog threshold
+struct SlowTask {
+    size_t                   worker;     // Index of the worker running the task
+    Priority                 priority;   // Priority of the task
+    const char*              tag;        // Tag passed to add(), may be null
+    uint64_t                 taskId;     // Submission sequence number of the task
+    std::chrono::nanoseconds elapsed;    // Running time when the task was detected
+};
+
+// Settings of the slow-task watchdog
+struct WatchdogOptions {
+    // Running time after which a task is reported, indexed by priorityIndex()
+    std::array<std::chrono::nanoseconds, PriorityLevels> thresholds{
+        std::chrono::seconds(1), std::chrono::seconds(1), std::chrono::seconds(1),
+        std::chrono::seconds(1), std::chrono::seconds(1) };
+    std::chrono::milliseconds            interval{ 100 };            // Time between two scans of the workers
+    std::function<void(const SlowTask&)> onSlowTask;                 // Called once per slow task, may be empty
+    size_t                               maxCompensatingWorkers{ 0 };// Extra workers spawned while tasks are stuck
+};
+
+// Outcome of submitting a task
+enum class AddStatus : uint8_t {
+    Queued,       // Task was queued
+    Shed,         // Task was refused by admission control
+    Rejected,     // Queue was full and the rejection policy refused the task
+    RanInline     // Queue was full and the task ran on the calling thread
+};
+
+// What add() does when the queue holds CapacityOptions::maxQueued tasks
+enum class RejectionPolicy : uint8_t {
+    Block,            // Wait until a worker takes a task; tasks adding tasks should not block, as all workers could wait
+    Throw,            // Throw std::length_error
+    Reject,           // Return AddStatus::Rejected
+    CallerRuns,       // Run the task on the calling thread, which slows the producer down
+    DiscardOldest,    // Drop the oldest queued task of the same priority, or reject if there is none
+    EvictLowest       // Drop the newest task of the lowest queued priority if it is below the new task's, or reject
+};
+
+// Settings of bounded mode
+struct CapacityOptions {
+    size_t                                 maxQueued{ 0 };                      // Queued tasks allowed, 0 for unbounded
+    RejectionPolicy                        policy{ RejectionPolicy::Block };    // Policy of add() calls that do not name one
+    std::function<void(const QueuedTask&)> onEvicted;                           // Called for each discarded task, may be empty; see QueuedTask::release
+};
+
+// Settings of fiber tasks
+struct FiberOptions {
+    size_t stackSize{ 256 << 10 };    // Usable stack bytes per fiber, a guard page is added below
+    size_t maxIdleFibers{ 64 };       // Finished fibers kept with their stacks for reuse
+};
+
+// Settings of admission control. A priority is overloaded while its oldest queued task has waited
+// longer than its target; priorities are then shed from Lowest upwards: Lowest once the worst wait
+// exceeds its target, Low once it exceeds twice the target, and so on up to maxShedPriority.
+struct AdmissionOptions {
+    // Queue wait target per priority, indexed by priorityIndex(); zero means no target
+    std::array<std::chrono::nanoseconds, PriorityLevels> targets{
+        std::chrono::nanoseconds(0), std::chrono::nanoseconds(0), std::chrono::nanoseconds(0),
+        std::chrono::milliseconds(10), std::chrono::milliseconds(1) };
+    Priority                               maxShedPriority{ Priority::Low };   // Highest priority that may be shed
+    bool                                   dropQueued{ false };                // Also remove queued tasks of shed priorities
+    std::function<void(const QueuedTask&)> onDropped;                          // Called for each removed task, may be empty; see QueuedTask::release
+};
+
+// Settings of the adaptive concurrency limiter. Every interval, the limit of each limited priority
+// is lowered by `backoff` when the execution time of its tasks or of any higher priority's tasks has
+// inflated past `tolerance` times its uncontended baseline, and raised by one otherwise (AIMD).
+struct ConcurrencyLimitOptions {
+    Priority                  maxLimitedPriority{ Priority::Normal };  // Highest priority whose concurrency is limited
+    double                    tolerance{ 1.5 };                        // Inflation above which limits shrink, above 1
+    double                    backoff{ 0.75 };                         // Factor applied to a limit when shrinking, in (0, 1)
+    size_t                    minLimit{ 1 };                           // Lowest limit, keeps every priority progressing; at least 1
+    std::chrono::milliseconds interval{ 100 };                         // Time between two limit adjustments
+};
+
+// Counters describing the pool's activity
+struct PoolStats {
+    uint64_t priorityChanges{ 0 };           // Successful OS thread priority changes
+    uint64_t priorityChangeFailures{ 0 };    // Failed OS thread priority changes
+    bool     osPriorityEnabled{ true };      // Whether workers still change their OS thread priority
+    uint64_t slowTasks{ 0 };                 // Tasks reported by the watchdog
+    uint64_t hugePageBytes{ 0 };             // Bytes mapped from reserved huge pages by the pool's HugePageResource
+    uint64_t transparentHugePageBytes{ 0 };  // Bytes advised for transparent huge pages by the pool's HugePageResource
+    uint64_t shedTasks{ 0 };                 // Submissions refused by admission control
+    uint64_t droppedTasks{ 0 };              // Queued tasks removed by admission control
+    std::array<size_t, PriorityLevels> concurrencyLimits{};    // Adaptive limit per priorityIndex(), 0 when unlimited
+    uint64_t rejectedTasks{ 0 };             // Submissions refused because the queue was full
+    uint64_t evictedTasks{ 0 };              // Queued tasks discarded to make room for another
+    uint64_t inlineTasks{ 0 };               // Submissions run on the calling thread because the queue was full
+    uint64_t blockingRegions{ 0 };           // Blocking regions covered by a compensating worker
+};
+
+// Aggregated cost of the tasks submitted under one tag or from one call site
+struct TagStats {
+    std::string              name;          // Tag, or file:line of the add() call for untagged tasks
+    uint64_t                 tasks{ 0 };    // Number of executed tasks
+    std::chrono::nanoseconds cpuTime{ 0 };  // Total thread CPU time spent running the tasks
+    std::chrono::nanoseconds wallTime{ 0 }; // Total wall time spent running the tasks
+    std::chrono::nanoseconds queueWait{ 0 };// Total time the tasks waited in the queue
+};
+
+// CPU time consumed by the calling thread, in nanoseconds
+[[nodiscard]] inline uint64_t threadCpuTime() {
+#ifdef __linux__
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000 + static_cast<uint64_t>(time.tv_nsec);
+#elif _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    const auto ticks = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime)
+                     + (static_cast<uint64_t>(user.dwHighDateTime) << 32 | user.dwLowDateTime);
+    return ticks * 100;    // FILETIME ticks are 100 nanoseconds
+#endif
+}
+
+// Hint to the CPU that the calling thread is spinning, saving power and yielding to a sibling hyperthread
+inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#elif _WIN32
+    YieldProcessor();
+#endif
+}
+
+class PriorityThreadPool {
+public:
+    // Deleted move and copy constructors and assignment operators
+    PriorityThreadPool(PriorityThreadPool&&) = delete;
+    PriorityThreadPool(const PriorityThreadPool&) = delete;
+    PriorityThreadPool& operator=(PriorityThreadPool&&) = delete;
+    PriorityThreadPool& operator=(const PriorityThreadPool&) = delete;
+
+    // Constructor for PriorityThreadPool. The queue's storage is allocated from the given memory
+    // resource, which must outlive the pool; it is only used with the pool's mutex held.
+    // Pass a HugePageResource to back the queue with huge pages and report them in stats().
+    explicit PriorityThreadPool(const size_t maxThreads = std::thread::hardware_concurrency(),
+                                std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_tasks(resource), m_resource(resource) {
+        if (maxThreads <= 0) {
+            throw std::invalid_argument("maxThreads must be greater than 0!");
+        }
+        if (resource == nullptr) {
+            throw std::invalid_argument("resource must not be null!");
+        }
+
+        std::lock_guard guard(m_workersMutex);
+        m_maxBlockingCompensation = maxThreads;
+        m_workers.reserve(maxThreads);  // Reserve space for workers in the vector
+        m_idleWorkers.reserve(maxThreads);
+
+        // Create threads and assign tasks to them
+        for (size_t i = 0; i < maxThreads; ++i) {
+            spawnWorker(false);
+        }
+    }
+
+    // Destructor for PriorityThreadPool
+    ~PriorityThreadPool() {
+        stopAsyncIo();       // Queue the callbacks of reads in flight
+        stopWatchdog();      // No more workers can be spawned after this
+        stopRealtimeSpinners();    // Before workers quit, as tasks still running on a spinner may queue more
+        {
+            // Set quit flag under the mutex so a worker between its wait predicate and going
+            // to sleep cannot miss the notification
+            std::lock_guard guard(m_mutex);
+            PRIORITY_THREAD_POOL_FUZZ_POINT();
+            m_quit = true;
+            wakeIdle();      // Wake all parked workers
+        }
+        m_notFull.notify_all();    // Release producers blocked on a full queue
+        // Join workers before the members they use are destroyed; blocking regions no longer spawn
+        // workers once m_quit is set, so the list is final
+        std::vector<std::unique_ptr<Worker>> workers;
+        {
+            std::lock_guard guard(m_workersMutex);
+            workers.swap(m_workers);
+        }
+        workers.clear();
+#ifdef __linux__
+        // Workers ran or released every queued handler, so only registrations are left
+        for (const auto& [fd, watch] : m_watches) {
+            delete watch;
+        }
+        for (const auto watch : m_retiredWatches) {
+            delete watch;
+        }
+        if (m_epoll >= 0) {
+            close(m_epoll);
+            close(m_leaderWake);
+        }
+#endif
+    }
+
+    // Set the number of workers of the process-wide pool before its first use, so libraries
+    // sharing it through PoolView stay within one thread budget. Returns false once global()
+    // has created the pool.
+    static bool setGlobalThreads(const size_t threads) {
+        if (threads == 0) {
+            throw std::invalid_argument("threads must be greater than 0!");
+        }
+        auto& budget = globalBudget();
+        std::lock_guard guard(budget.mutex);
+        if (budget.claimed) {
+            return false;
+        }
+        budget.threads = threads;
+        return true;
+    }
+
+    // Process-wide pool, created on first use with hardware_concurrency() workers unless
+    // setGlobalThreads() chose otherwise. It is destroyed at exit, so it must not be used
+    // from destructors of other static objects.
+    [[nodiscard]] static PriorityThreadPool& global() {
+        static PriorityThreadPool pool([] {
+            auto& budget = globalBudget();
+            std::lock_guard guard(budget.mutex);
+            budget.claimed = true;
+            return budget.threads;
+        }());
+        return pool;
+    }
+
+    // Add a task to the thread pool with specified priority. The optional tag names the task in
+    // watchdog reports and cost accounting and must have static storage duration, e.g. a string literal.
+    // Returns AddStatus::Shed if admission control refused the task.
+    AddStatus add(Task task, const Priority priority = Priority::Normal, const char* tag = nullptr,
+                  const std::source_location location = std::source_location::current()) {
+        return submit(std::move(task), priority, std::nullopt, tag, location, nullptr);
+    }
+
+    // Add a task, handling a full queue with the given policy instead of the pool's default
+    AddStatus add(Task task, const Priority priority, const RejectionPolicy policy, const char* tag = nullptr,
+                  const std::source_location location = std::source_location::current()) {
+        return submit(std::move(task), priority, policy, tag, location, nullptr);
+    }
+
+    // Add a task whose callable is allocated from the given memory resource instead of the global
+    // heap. The callable is destroyed and its memory returned right after it runs, on the worker
+    // thread, so the resource must be thread-safe if it is also used elsewhere concurrently.
+    template<typename Function>
+    AddStatus add(std::pmr::memory_resource* resource, Function&& func, const Priority priority = Priority::Normal,
+                  const char* tag = nullptr, const std::source_location location = std::source_location::current()) {
+        using Callable = std::decay_t<Function>;
+        std::pmr::polymorphic_allocator<Callable> allocator(resource);
+        const auto callable = allocator.allocate(1);
+        try {
+            std::construct_at(callable, std::forward<Function>(func));
+        } catch (...) {
+            allocator.deallocate(callable, 1);
+            throw;
+        }
+        try {
+            // Capturing only two pointers keeps the wrapper in std::function's small buffer
+            return submit(ResourceCall<Callable>{ callable, resource }, priority, std::nullopt, tag, location,
+                          releaseCall<Callable>);
+        } catch (...) {
+            release(callable, resource);
+            throw;
+        }
+    }
+
+    // Add `count` work items produced on demand instead of materialized tasks: the generator occupies
+    // one queue slot, and each worker that reaches it claims the next index and runs body(index), so
+    // items run concurrently while memory stays constant in `count`. remainingTasks() counts the
+    // generator as one task. If the queue is full and the policy runs tasks inline, all items run
+    // on the calling thread.
+    template<typename Body>
+    AddStatus addGenerator(const Priority priority, const size_t count, Body&& body, const char* tag = nullptr,
+                           const std::source_location location = std::source_location::current()) {
+        if (count == 0) {
+            return AddStatus::Queued;
+        }
+        const auto generator = new TaskGenerator{ std::forward<Body>(body), 0, count };
+        try {
+            return submit(GeneratorItem{ generator, GeneratorItem::Remaining }, priority, std::nullopt, tag, location,
+                          releaseGenerator);
+        } catch (...) {
+            delete generator;
+            throw;
+        }
+    }
+
+    // Add a task that runs on its own stack (a fiber). When it waits on a FiberEvent or calls
+    // yieldFiber(), the fiber is suspended and its worker moves on to the next task; once woken,
+    // the fiber is queued again with its priority and continues on whichever worker takes it.
+    // Fibers must not hold a std::mutex or rely on thread_local state across a wait. Fibers still
+    // waiting when the pool is destroyed are leaked, as their waits can never complete.
+    AddStatus addFiber(Task task, const Priority priority = Priority::Normal, const char* tag = nullptr,
+                       const std::source_location location = std::source_location::current()) {
+        return submit([this, body = std::move(task), priority, tag, location]() mutable {
+                auto& fiber = acquireFiber();
+                fiber.body = std::move(body);
+                fiber.priority = priority;
+                fiber.tag = tag;
+                fiber.location = location;
+                enterFiber(fiber);
+            }, priority, std::nullopt, tag, location, nullptr);
+    }
+
+    // Set the stack size and reuse cache of fibers created from now on
+    void setFiberOptions(const FiberOptions& options) {
+        if (options.stackSize == 0) {
+            throw std::invalid_argument("stackSize must be greater than 0!");
+        }
+        std::lock_guard guard(m_fibersMutex);
+        m_fiberOptions = options;
+        while (m_idleFibers.size() > options.maxIdleFibers) {
+            m_idleFibers.pop_back();
+        }
+    }
+
+    // Whether the calling code runs on a fiber of addFiber()
+    [[nodiscard]] static bool inFiber() noexcept {
+        return runningFiber() != nullptr;
+    }
+
+    // Let queued tasks of the same or higher priority run before the calling fiber continues;
+    // outside a fiber, yields the thread
+    static void yieldFiber() {
+        const auto fiber = runningFiber();
+        if (fiber == nullptr) {
+            std::this_thread::yield();
+            return;
+        }
+        fiber->requeue = true;
+        leaveFiber(*fiber);
+    }
+
+    // Guard of blockingRegion(); ends the region when destroyed
+    class BlockingRegion {
+    public:
+        BlockingRegion(const BlockingRegion&) = delete;
+        BlockingRegion& operator=(const BlockingRegion&) = delete;
+
+        ~BlockingRegion() {
+            if (m_blocking != nullptr) {
+                m_pool.endBlocking(*m_blocking);
+            }
+        }
+
+        // Whether a compensating worker covers the region
+        [[nodiscard]] bool compensated() const noexcept {
+            return m_blocking != nullptr;
+        }
+
+    private:
+        friend class PriorityThreadPool;
+
+        BlockingRegion(PriorityThreadPool& pool, std::atomic_bool* blocking) noexcept
+            : m_pool(pool), m_blocking(blocking) {}
+
+        PriorityThreadPool& m_pool;        // Pool of the blocked worker
+        std::atomic_bool*   m_blocking;    // Flag of the blocked worker, null when not compensated
+    };
+
+    // Tell the pool that the calling task is about to block, e.g. on a file read or a synchronous
+    // client, until the returned guard is destroyed. Up to setMaxBlockingCompensation() regions at
+    // a time get a compensating worker, so queued tasks keep flowing; it retires after its current
+    // task once the region ended. Called from outside the pool's workers, within another region or
+    // past the cap, the guard does nothing.
+    [[nodiscard]] BlockingRegion blockingRegion() {
+        const auto worker = runningWorker();
+        if (worker == nullptr || worker->pool != this || worker->blocking.load(std::memory_order_relaxed)) {
+            return { *this, nullptr };
+        }
+        std::lock_guard guard(m_workersMutex);
+        if (m_quit || m_blockedWorkers.load() >= m_maxBlockingCompensation) [[unlikely]] {
+            return { *this, nullptr };
+        }
+        worker->blocking.store(true, std::memory_order_relaxed);
+        ++m_blockedWorkers;
+        m_blockingRegions.fetch_add(1, std::memory_order_relaxed);
+        compensate(m_stuckWorkers.load() + m_blockedWorkers.load());
+        return { *this, &worker->blocking };
+    }
+
+    // Set how many blocking regions may be compensated at once; defaults to the initial worker count
+    void setMaxBlockingCompensation(const size_t workers) {
+        std::lock_guard guard(m_workersMutex);
+        m_maxBlockingCompensation = workers;
+    }
+
+    // Awaitable read of readAsync(); the coroutine resumes on a worker at the read's priority
+    class ReadAwaiter {
+    public:
+        [[nodiscard]] bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(const std::coroutine_handle<> handle) {
+            m_pool.readAsync(m_fd, m_buffer, m_offset, m_priority, [this, handle](const int64_t result) {
+                    m_result = result;
+                    handle.resume();
+                }, m_tag, m_location);
+        }
+
+        // Number of bytes read, or a negative errno
+        [[nodiscard]] int64_t await_resume() const noexcept {
+            return m_result;
+        }
+
+    private:
+        friend class PriorityThreadPool;
+
+        ReadAwaiter(PriorityThreadPool& pool, const int fd, const std::span<std::byte> buffer, const uint64_t offset,
+                    const Priority priority, const char* tag, const std::source_location& location) noexcept
+            : m_pool(pool), m_fd(fd), m_buffer(buffer), m_offset(offset), m_priority(priority), m_tag(tag),
+              m_location(location) {}
+
+        PriorityThreadPool&   m_pool;
+        int                   m_fd;
+        std::span<std::byte>  m_buffer;
+        uint64_t              m_offset;
+        Priority              m_priority;
+        const char*           m_tag;
+        std::source_location  m_location;
+        int64_t               m_result{ 0 };
+    };
+
+    // Submit file reads to an io_uring instance and reap their completions on a dedicated thread,
+    // so readAsync() no longer holds a worker while the disk works. Requires Linux 5.6 or newer.
+    // Returns false if it is already started or io_uring is unavailable; reads then keep using
+    // the blocking fallback.
+    bool startAsyncIo(const unsigned entries = 256) {
+        std::lock_guard guard(m_ioMutex);
+        if (m_ioReaper.joinable() || entries == 0 || !m_ioRing.open(entries)) {
+            return false;
+        }
+        m_ioStopping = false;
+        m_ioReaper = std::jthread([this] { reapLoop(); });
+        return true;
+    }
+
+    // Stop submitting new reads to io_uring, wait for the submitted and waiting ones to be queued
+    // and close the ring
+    void stopAsyncIo() {
+        std::unique_lock lock(m_ioMutex);
+        if (!m_ioReaper.joinable()) {
+            return;
+        }
+        m_ioStopping = true;
+        while (!m_ioRing.nop(0)) {    // Wakes the reaper; it closes the ring once everything completed
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+        lock.unlock();
+        m_ioReaper.join();
+    }
+
+    // Read up to buffer.size() bytes at `offset` of `fd`, then queue callback(result) at the given
+    // priority, where result is the number of bytes read or a negative errno. After startAsyncIo()
+    // the read goes through io_uring and holds no worker; otherwise, or when the ring is full, a
+    // task at the given priority reads inside a blockingRegion(). Reads are never shed or rejected;
+    // if admission control or eviction drops the queued callback, it gets -ECANCELED on the thread
+    // that dropped it. The buffer must stay valid until the callback runs.
+    void readAsync(const int fd, const std::span<std::byte> buffer, const uint64_t offset, const Priority priority,
+                   std::function<void(int64_t)> callback, const char* tag = nullptr,
+                   const std::source_location location = std::source_location::current()) {
+        const auto request = new IoRequest{ this, std::move(callback), fd, buffer, offset, priority, tag, location };
+        {
+            std::lock_guard guard(m_ioMutex);
+            if (m_ioReaper.joinable() && !m_ioStopping) [[likely]] {
+                if (m_ioInFlight < m_ioRing.entries() && m_ioBacklog.empty() && submitRead(*request)) [[likely]] {
+                    return;
+                }
+                if (m_ioInFlight != 0) {    // The reaper submits it once a completion frees an entry
+                    m_ioBacklog.push_back(request);
+                    return;
+                }
+            }
+        }
+        std::lock_guard guard(m_mutex);
+        if (!spinnerTakes(priority)) {
+            wakeIdle(1);
+        }
+        push(IoCompletion{ request }, priority, tag, location, releaseIoRequest);
+    }
+
+    // Awaitable variant of readAsync(): `const auto result = co_await pool.readAsync(fd, buffer, offset);`
+    [[nodiscard]] ReadAwaiter readAsync(const int fd, const std::span<std::byte> buffer, const uint64_t offset,
+                                        const Priority priority = Priority::Normal, const char* tag = nullptr,
+                                        const std::source_location location = std::source_location::current()) {
+        return { *this, fd, buffer, offset, priority, tag, location };
+    }
+
+    // Run handler(readyEvents) as a task at the given priority whenever `fd` becomes ready for the
+    // given epoll events (EPOLLIN, EPOLLOUT, ...). There is no reactor thread: an idle worker waits
+    // in epoll_wait() as the leader instead of parking and queues the handlers of all ready
+    // descriptors at once; while every worker is busy, readiness is picked up by the next one to go
+    // idle. The descriptor is re-armed once its handler returned, so a handler never runs twice at
+    // once. Returns false if the descriptor is already watched, epoll refuses it or the platform is
+    // not Linux.
+    bool watch(const int fd, const uint32_t events, const Priority priority, std::function<void(uint32_t)> handler,
+               const char* tag = nullptr, const std::source_location location = std::source_location::current()) {
+#ifdef __linux__
+        std::lock_guard guard(m_reactorMutex);
+        if (!openReactor() || m_watches.contains(fd)) {
+            return false;
+        }
+        const auto watch = new Watch{ this, fd, events, priority, std::move(handler), tag, location };
+        epoll_event event{ events | EPOLLONESHOT, { .ptr = watch } };
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            delete watch;
+            return false;
+        }
+        m_watches.emplace(fd, watch);
+        return true;
+#else
+        static_cast<void>(fd);
+        static_cast<void>(events);
+        static_cast<void>(priority);
+        static_cast<void>(handler);
+        static_cast<void>(tag);
+        static_cast<void>(location);
+        return false;
+#endif
+    }
+
+    // Stop watching a descriptor; call before closing it. A handler already running may still
+    // finish after this returns, but no further one starts. Returns false if it was not watched.
+    bool unwatch(const int fd) {
+#ifdef __linux__
+        std::lock_guard guard(m_reactorMutex);
+        const auto found = m_watches.find(fd);
+        if (found == m_watches.end()) {
+            return false;
+        }
+        const auto watch = found->second;
+        m_watches.erase(found);
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        watch->removed.store(true, std::memory_order_relaxed);
+        m_retiredWatches.push_back(watch);    // A leader may still hold it from its last epoll_wait()
+        return true;
+#else
+        static_cast<void>(fd);
+        return false;
+#endif
+    }
+
+    // Add multiple tasks to the thread pool; returns the number of queued tasks. Tasks that do not
+    // fit a full queue are handled one by one with the pool's rejection policy; with Throw, the
+    // tasks before the first one that did not fit stay queued.
+    size_t add(std::span<TaskPriority> tasks, const std::source_location location = std::source_location::current()) {
+        size_t queued = 0;
+        auto full = false;
+        std::vector<QueuedTask> dropped, evicted;
+        std::vector<Task> inlineTasks;
+        {
+            // Lock mutex for thread safety
+            std::unique_lock lock(m_mutex);
+            // Add each admitted task to the queue
+            for (const auto& [task, priority] : tasks) {
+                if (m_admitting && !admit(priority, dropped)) [[unlikely]] {
+                    continue;
+                }
+                const auto policy = m_capacityOptions.policy;
+                const auto status = reserve(lock, priority, policy, evicted);
+                if (status == AddStatus::RanInline) [[unlikely]] {
+                    inlineTasks.push_back(task);
+                    continue;
+                }
+                if (status != AddStatus::Queued) [[unlikely]] {
+                    if (policy == RejectionPolicy::Throw) {
+                        full = true;
+                        break;
+                    }
+                    continue;
+                }
+                push(Task(task), priority, nullptr, location, nullptr);
+                ++queued;
+            }
+            PRIORITY_THREAD_POOL_PROBE(bulk_add, tasks.size(), m_tasks.size());
+            PRIORITY_THREAD_POOL_FUZZ_POINT();
+            wakeIdle(queued);    // Wake as many workers as there are new tasks
+        }
+        drop(dropped, m_admissionOptions.onDropped);
+        drop(evicted, m_capacityOptions.onEvicted);
+        for (const auto& task : inlineTasks) {
+            task();
+        }
+        if (full) {
+            throw std::length_error("task queue is full!");
+        }
+        return queued;
+    }
+
+    // Get the number of remaining tasks in the queue
+    [[nodiscard]] size_t remainingTasks() const {
+        std::lock_guard guard(m_mutex);    // Lock mutex for read
+        return m_tasks.size();             // Return the size of the queue
+    }
+
+    // Check if there are remaining tasks in the queue
+    [[nodiscard]] bool hasRemainingTasks() const {
+        std::lock_guard guard(m_mutex);     // Lock mutex for read
+        return !m_tasks.empty();            // Return true if queue is not empty
+    }
+
+    // Start recording task lifecycle events; the capacity is only honored on the first call
+    void startTracing(const size_t eventsPerWorker = 1 << 16) {
+        {
+            std::lock_guard guard(m_workersMutex);
+            if (m_traceCapacity == 0) {
+                m_traceCapacity = eventsPerWorker;
+                m_producerTrace.allocate(eventsPerWorker);
+                for (auto& worker : m_workers) {
+                    worker->trace.allocate(eventsPerWorker);
+                }
+            }
+        }
+        m_recording.fetch_or(RecordTrace, std::memory_order_release);
+    }
+
+    // Stop recording task lifecycle events; recorded events are kept for export
+    void stopTracing() {
+        m_recording.fetch_and(~RecordTrace, std::memory_order_release);
+    }
+
+    // Start the always-on flight recorder, keeping the last `records` scheduling events in a
+    // memory-mapped file for postmortem analysis (see tools/flight_recorder_decode.cpp).
+    // Returns false if it is already running, the file cannot be mapped or the platform is not Linux.
+    bool startFlightRecorder(const std::string& path, const size_t records = 1 << 20) {
+        const auto epochUnixNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count() - static_cast<int64_t>(elapsed());
+        if (!m_flightRecorder.open(path, records, epochUnixNs)) {
+            return false;
+        }
+        m_recording.fetch_or(RecordFlightRecorder, std::memory_order_release);
+        return true;
+    }
+
+    // Write the recorded events in Chrome trace JSON format (chrome://tracing, ui.perfetto.dev).
+    // Call after stopTracing() and once in-flight tasks finished for a consistent snapshot.
+    void writeChromeTrace(std::ostream& os) const {
+        std::vector<TraceRecord> records;
+        {
+            std::lock_guard guard(m_mutex);    // Producer ring is written under the mutex
+            m_producerTrace.forEach([&records](const auto& record) { records.push_back(record); });
+        }
+        std::lock_guard guard(m_workersMutex);
+        for (const auto& worker : m_workers) {
+            worker->trace.forEach([&records](const auto& record) { records.push_back(record); });
+        }
+        writeChromeTraceRecords(os, std::move(records), m_workers.size());
+    }
+
+    // Start a watchdog thread reporting tasks that run longer than their priority's threshold.
+    // Returns false if the watchdog is already running.
+    bool startWatchdog(WatchdogOptions options) {
+        std::lock_guard guard(m_watchdogMutex);
+        if (m_watchdog.joinable()) {
+            return false;
+        }
+        m_watchdogOptions = std::move(options);
+        m_watching.store(true, std::memory_order_relaxed);
+        m_watchdog = std::jthread([this](const std::stop_token token) { watchdogLoop(token); });
+        return true;
+    }
+
+    // Stop the watchdog; compensating workers retire once they finish their current task
+    void stopWatchdog() {
+        std::lock_guard guard(m_watchdogMutex);
+        if (!m_watchdog.joinable()) {
+            return;
+        }
+        m_watchdog.request_stop();
+        m_watchdog.join();
+        m_watching.store(false, std::memory_order_relaxed);
+        updateStuckWorkers(0);
+    }
+
+    // Number of tasks reported by the watchdog so far
+    [[nodiscard]] uint64_t slowTasks() const {
+        return m_slowTasks.load(std::memory_order_relaxed);
+    }
+
+    // Start shedding low-priority submissions while queue waits exceed their targets (see AdmissionOptions).
+    // Only tasks added from now on have their queue wait measured.
+    void startAdmissionControl(AdmissionOptions options) {
+        std::lock_guard guard(m_mutex);
+        m_admissionOptions = std::move(options);
+        m_admitting = true;
+    }
+
+    // Stop admission control; every submission is queued again
+    void stopAdmissionControl() {
+        std::lock_guard guard(m_mutex);
+        m_admitting = false;
+    }
+
+    // Bound the number of queued tasks; add() then applies a rejection policy when the queue is full.
+    // A maxQueued of 0 makes the queue unbounded again and releases blocked producers.
+    void setCapacity(CapacityOptions options) {
+        {
+            std::lock_guard guard(m_mutex);
+            m_capacityOptions = std::move(options);
+        }
+        m_notFull.notify_all();    // The bound may have grown
+    }
+
+    // Dedicate one busy-polling worker per listed core to Realtime tasks. Spinners are pinned to
+    // their core, never park, and pick Realtime tasks up without a futex wake-up, trading that
+    // core's power for latency; isolate the cores (e.g. isolcpus) so nothing else runs there.
+    // Realtime submissions do not wake parked workers while a spinner is idle to take them.
+    // Returns false if spinners are already running or a thread cannot be pinned.
+    bool startRealtimeSpinners(std::span<const int> cores) {
+        std::lock_guard guard(m_workersMutex);
+        if (!m_spinners.empty() || cores.empty()) {
+            return false;
+        }
+        for (const auto core : cores) {
+            auto& worker = claimWorker(false);
+            worker.thread = std::jthread([this, &worker](const std::stop_token token) { spinLoop(worker, token); });
+            m_spinners.push_back(&worker);
+            if (!pinThread(worker.thread, core)) {
+                stopSpinners();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Stop the Realtime spinners; queued Realtime tasks go back to the regular workers
+    void stopRealtimeSpinners() {
+        std::lock_guard guard(m_workersMutex);
+        stopSpinners();
+    }
+
+    // Start limiting how many workers run each low priority at once, adapting the limits to the
+    // measured inflation of task execution times (see ConcurrencyLimitOptions). Limits start at
+    // the number of workers.
+    void startConcurrencyLimit(const ConcurrencyLimitOptions& options) {
+        if (options.minLimit == 0) {
+            throw std::invalid_argument("minLimit must be greater than 0!");    // 0 means unlimited
+        }
+        if (!(options.backoff > 0 && options.backoff < 1)) {
+            throw std::invalid_argument("backoff must be between 0 and 1!");
+        }
+        if (!(options.tolerance > 1)) {
+            throw std::invalid_argument("tolerance must be greater than 1!");
+        }
+        size_t workers;
+        {
+            std::lock_guard guard(m_workersMutex);
+            workers = m_workers.size();
+        }
+        std::lock_guard guard(m_mutex);
+        m_limiter = {};
+        m_limiter.options = options;
+        m_limiter.maxLimit = std::max(workers, options.minLimit);
+        m_limiter.adjustedAt = elapsed();
+        m_blockedLevels = 0;
+        for (size_t level = 0; level <= priorityIndex(options.maxLimitedPriority); ++level) {
+            m_limiter.limits[level] = m_limiter.maxLimit;
+        }
+        m_limiting.store(true, std::memory_order_relaxed);
+    }
+
+    // Stop limiting concurrency; blocked priorities become runnable again
+    void stopConcurrencyLimit() {
+        {
+            std::lock_guard guard(m_mutex);
+            m_limiting.store(false, std::memory_order_relaxed);
+            m_limiter.limits = {};
+            m_blockedLevels = 0;
+            wakeIdle();
+        }
+    }
+
+    // Turn OS thread priority changes on or off; a worker keeps the OS priority it last set
+    void setOsPriorityEnabled(const bool enabled) {
+        m_osPriority.store(enabled, std::memory_order_relaxed);
+    }
+
+    // Set the function called once, with the error code, when changing a thread's OS priority fails.
+    // Priority changes are turned off after the first failure, e.g. when running unprivileged.
+    void setPriorityChangeFailureHandler(std::function<void(int)> handler) {
+        std::lock_guard guard(m_failureMutex);
+        m_priorityChangeFailureHandler = std::move(handler);
+    }
+
+    // Get the pool's counters
+    [[nodiscard]] PoolStats stats() const {
+        PoolStats stats;
+        stats.osPriorityEnabled = m_osPriority.load(std::memory_order_relaxed);
+        stats.slowTasks = slowTasks();
+        stats.shedTasks = m_shedTasks.load(std::memory_order_relaxed);
+        stats.droppedTasks = m_droppedTasks.load(std::memory_order_relaxed);
+        stats.rejectedTasks = m_rejectedTasks.load(std::memory_order_relaxed);
+        stats.evictedTasks = m_evictedTasks.load(std::memory_order_relaxed);
+        stats.inlineTasks = m_inlineTasks.load(std::memory_order_relaxed);
+        stats.blockingRegions = m_blockingRegions.load(std::memory_order_relaxed);
+        {
+            std::lock_guard guard(m_mutex);
+            stats.concurrencyLimits = m_limiter.limits;
+        }
+        if (const auto hugePages = dynamic_cast<const HugePageResource*>(m_resource)) {
+            stats.hugePageBytes = hugePages->hugePageBytes();
+            stats.transparentHugePageBytes = hugePages->transparentHugePageBytes();
+        }
+        std::lock_guard guard(m_workersMutex);
+        for (const auto& worker : m_workers) {
+            stats.priorityChanges += worker->priorityChanges.load(std::memory_order_relaxed);
+            stats.priorityChangeFailures += worker->priorityChangeFailures.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    // Start aggregating count, CPU time, wall time and queue wait per tag or call site
+    void startAccounting() {
+        m_accounting.store(true, std::memory_order_relaxed);
+    }
+
+    // Stop aggregating task costs; collected costs are kept
+    void stopAccounting() {
+        m_accounting.store(false, std::memory_order_relaxed);
+    }
+
+    // Get the aggregated task costs, most CPU time first
+    [[nodiscard]] std::vector<TagStats> accountingSnapshot() const {
+        std::unordered_map<std::string, TagStats> merged;
+        {
+            std::lock_guard guard(m_workersMutex);
+            for (const auto& worker : m_workers) {
+                std::lock_guard costsGuard(worker->costsMutex);
+                for (const auto& [site, cost] : worker->costs) {
+                    auto name = site.tag != nullptr ? std::string(site.tag)
+                        : std::string(site.file) + ":" + std::to_string(site.line);
+                    auto& stats = merged[name];
+                    stats.name = std::move(name);
+                    stats.tasks += cost.tasks;
+                    stats.cpuTime += cost.cpuTime;
+                    stats.wallTime += cost.wallTime;
+                    stats.queueWait += cost.queueWait;
+                }
+            }
+        }
+        std::vector<TagStats> snapshot;
+        snapshot.reserve(merged.size());
+        for (auto& [name, stats] : merged) {
+            snapshot.push_back(std::move(stats));
+        }
+        std::sort(snapshot.begin(), snapshot.end(), [](const auto& first, const auto& second) {
+            return first.cpuTime > second.cpuTime;
+        });
+        return snapshot;
+    }
+
+private:
+    // Task wrapper of add(resource, ...); trivially copyable so it fits std::function's small buffer
+    template<typename Callable>
+    struct ResourceCall {
+        Callable*                  callable;
+        std::pmr::memory_resource* resource;
+
+        void operator()() const {
+            (*callable)();
+        }
+    };
+
+    // Destroy a callable allocated by add(resource, ...) and return its memory to the resource
+    template<typename Callable>
+    static void release(Callable* callable, std::pmr::memory_resource* resource) {
+        std::destroy_at(callable);
+        std::pmr::polymorphic_allocator<Callable>(resource).deallocate(callable, 1);
+    }
+
+    // Release hook of add(resource, ...), run once the task ran or was dropped
+    template<typename Callable>
+    static void releaseCall(const Task& task) {
+        const auto call = task.target<ResourceCall<Callable>>();
+        release(call->callable, call->resource);
+    }
+
+    // Work items of addGenerator(), shared by its queue slot and the items claimed from it
+    struct TaskGenerator {
+        std::function<void(size_t)> body;                 // Runs one item
+        size_t                      next{ 0 };            // Next index to claim, guarded by m_mutex while queued
+        size_t                      count{ 0 };           // Number of items
+        std::atomic_size_t          references{ 1 };      // Queue slot plus claimed items that did not finish
+    };
+
+    // Task of a generator's queue slot and of its claimed items; trivially copyable so it fits
+    // std::function's small buffer
+    struct GeneratorItem {
+        static constexpr size_t Remaining = SIZE_MAX;     // Index of the queue slot: runs every unclaimed item
+
+        TaskGenerator* generator;
+        size_t         index;
+
+        void operator()() const {
+            if (index != Remaining) {
+                generator->body(index);
+                return;
+            }
+            while (generator->next < generator->count) {
+                generator->body(generator->next++);
+            }
+        }
+    };
+
+    // Release hook of generator slots and items; the last one frees the generator
+    static void releaseGenerator(const Task& task) {
+        const auto generator = task.target<GeneratorItem>()->generator;
+        if (generator->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete generator;
+        }
+    }
+
+    // Remove the oldest task of a level, or claim the next item of the generator at its front,
+    // leaving the generator queued while items remain; requires m_mutex
+    [[nodiscard]] QueuedTask takeTask(const size_t level) {
+        const auto& front = m_tasks.front(Priorities[level]);
+        if (front.release != releaseGenerator) [[likely]] {
+            return m_tasks.take(level);
+        }
+        const auto generator = front.task.target<GeneratorItem>()->generator;
+        QueuedTask item{ GeneratorItem{ generator, generator->next++ }, front.priority, front.id, front.tag,
+                         front.location, front.enqueuedAt, releaseGenerator };
+        if (generator->next == generator->count) {
+            static_cast<void>(m_tasks.take(level));    // The last item inherits the slot's reference
+        } else {
+            generator->references.fetch_add(1, std::memory_order_relaxed);
+            wakeIdle(1);                               // Let another worker claim the next item
+        }
+        return item;
+    }
+
+    // Task run on its own stack, pooled and reused once it finished
+    struct Fiber {
+        PriorityThreadPool*  pool{ nullptr };           // Pool whose workers run the fiber
+        Task                 body;                      // Task of addFiber(), empty while idle
+        Priority             priority{ Priority::Normal };
+        const char*          tag{ nullptr };
+        std::source_location location;
+        std::mutex*          unlockOnLeave{ nullptr };  // Unlocked by the worker once the fiber's context is saved
+        bool                 requeue{ false };          // Queued again by the worker once the context is saved
+        bool                 finished{ false };         // Body returned, the fiber can be reused
+#ifdef __linux__
+        ucontext_t           context{};                 // Saved context of the fiber
+        ucontext_t           workerContext{};           // Saved context of the worker running the fiber
+        void*                mapping{ nullptr };        // Stack and guard page
+        size_t               mappedBytes{ 0 };
+
+        ~Fiber() {
+            if (mapping != nullptr) {
+                munmap(mapping, mappedBytes);
+            }
+        }
+#elif _WIN32
+        void*                handle{ nullptr };         // Fiber of the task
+        void*                worker{ nullptr };         // Fiber of the worker running the task
+
+        ~Fiber() {
+            if (handle != nullptr) {
+                DeleteFiber(handle);
+            }
+        }
+#endif
+    };
+
+    // Task that continues a suspended fiber; trivially copyable so it fits std::function's small buffer
+    struct FiberResume {
+        Fiber* fiber;
+
+        void operator()() const {
+            fiber->pool->enterFiber(*fiber);
+        }
+    };
+
+    // Whether a queued task may be evicted or dropped; a fiber's resumption may not, as the fiber
+    // would never continue
+    static bool removable(const QueuedTask& task) noexcept {
+        return task.task.target<FiberResume>() == nullptr;
+    }
+
+    // Fiber running on this thread, or null
+    PRIORITY_THREAD_POOL_NOINLINE static Fiber*& runningFiber() noexcept {
+        static thread_local Fiber* fiber = nullptr;
+        return fiber;
+    }
+
+    // Take an idle fiber or create one with a fresh stack
+    Fiber& acquireFiber() {
+        std::unique_lock lock(m_fibersMutex);
+        if (!m_idleFibers.empty()) {
+            auto fiber = m_idleFibers.back().release();
+            m_idleFibers.pop_back();
+            return *fiber;
+        }
+        const auto stackSize = m_fiberOptions.stackSize;
+        lock.unlock();
+        auto fiber = std::make_unique<Fiber>();
+        fiber->pool = this;
+#ifdef __linux__
+        const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        fiber->mappedBytes = (stackSize + page - 1) / page * page + page;
+        const auto mapping = mmap(nullptr, fiber->mappedBytes, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        fiber->mapping = mapping;
+        mprotect(mapping, page, PROT_NONE);         // Guard page: an overflow faults instead of corrupting memory
+        makeFiberContext(fiber->context, static_cast<char*>(mapping) + page, fiber->mappedBytes - page);
+#elif _WIN32
+        fiber->handle = CreateFiber(stackSize, [](void*) { fiberMain(); }, nullptr);
+        if (fiber->handle == nullptr) {
+            throw std::bad_alloc();
+        }
+#endif
+        return *fiber.release();
+    }
+
+#ifdef __linux__
+    // Prepare a context starting fiberMain() on the given stack; kept apart from acquireFiber()
+    // as getcontext() returns twice
+    static void makeFiberContext(ucontext_t& context, void* stack, const size_t size) {
+        getcontext(&context);
+        context.uc_stack.ss_sp = stack;
+        context.uc_stack.ss_size = size;
+        context.uc_link = nullptr;
+        makecontext(&context, fiberMain, 0);
+    }
+#endif
+
+    // Entry point of every fiber: runs one body after another, switching back to the worker in between
+    static void fiberMain() noexcept {
+        const auto self = runningFiber();    // Read once: later bodies may run on other threads
+        while (true) {
+            self->body();
+            self->body = nullptr;            // Release the captures before the fiber is reused
+            self->finished = true;
+            leaveFiber(*self);
+        }
+    }
+
+    // Run a fiber on the calling worker until it finishes or leaves, then do what it asked for
+    void enterFiber(Fiber& fiber) {
+        runningFiber() = &fiber;
+#ifdef __linux__
+        swapcontext(&fiber.workerContext, &fiber.context);
+#elif _WIN32
+        if (!IsThreadAFiber()) {
+            ConvertThreadToFiber(nullptr);
+        }
+        fiber.worker = GetCurrentFiber();
+        SwitchToFiber(fiber.handle);
+#endif
+        runningFiber() = nullptr;
+        // The fiber may run elsewhere as soon as it is unlocked or queued, so read it first
+        if (fiber.finished) {
+            fiber.finished = false;
+            releaseFiber(fiber);
+        } else if (fiber.unlockOnLeave != nullptr) {
+            const auto mutex = fiber.unlockOnLeave;
+            fiber.unlockOnLeave = nullptr;
+            mutex->unlock();
+        } else if (fiber.requeue) {
+            fiber.requeue = false;
+            resumeFiber(fiber);
+        }
+    }
+
+    // Switch from a fiber back to the worker that entered it
+    static void leaveFiber(Fiber& fiber) {
+#ifdef __linux__
+        swapcontext(&fiber.context, &fiber.workerContext);
+#elif _WIN32
+        SwitchToFiber(fiber.worker);
+#endif
+    }
+
+    // Keep a finished fiber for reuse, or free it if enough are idle
+    void releaseFiber(Fiber& fiber) {
+        std::unique_ptr<Fiber> owned(&fiber);
+        std::lock_guard guard(m_fibersMutex);
+        if (m_idleFibers.size() < m_fiberOptions.maxIdleFibers) {
+            m_idleFibers.push_back(std::move(owned));
+        }
+    }
+
+    // Queue a suspended fiber again with its priority; it was admitted already, so neither
+    // admission control nor the capacity bound apply, and neither evicts nor drops the resumption
+    void resumeFiber(Fiber& fiber) {
+        Worker* woken;
+        {
+            std::lock_guard guard(m_mutex);
+            woken = spinnerTakes(fiber.priority) ? nullptr : popIdle();
+            push(FiberResume{ &fiber }, fiber.priority, fiber.tag, fiber.location, nullptr);
+        }
+        if (woken != nullptr) {
+            woken->parked.release();
+        }
+    }
+
+    // Read of readAsync(), from submission until its callback ran or was cancelled
+    struct IoRequest {
+        PriorityThreadPool*         pool;
+        std::function<void(int64_t)> callback;
+        int                         fd;
+        std::span<std::byte>        buffer;
+        uint64_t                    offset;
+        Priority                    priority;
+        const char*                 tag;
+        std::source_location        location;
+        bool                        reaped{ false };    // result came from io_uring, no fallback read needed
+        bool                        called{ false };    // callback ran
+        int64_t                     result{ 0 };
+    };
+
+    // Task running a read's callback, reading first if io_uring did not; trivially copyable so it
+    // fits std::function's small buffer
+    struct IoCompletion {
+        IoRequest* request;
+
+        void operator()() const {
+            if (!request->reaped) {
+                auto region = request->pool->blockingRegion();
+                request->result = positionalRead(request->fd, request->buffer, request->offset);
+            }
+            request->called = true;
+            request->callback(request->result);
+        }
+    };
+
+    // Release hook of read callbacks: cancels a dropped callback and frees the request
+    static void releaseIoRequest(const Task& task) {
+        const auto request = task.target<IoCompletion>()->request;
+        if (!request->called) {
+            request->callback(-ECANCELED);
+        }
+        delete request;
+    }
+
+    // Blocking read at an offset, leaving the file position alone; returns the bytes read or a negative errno
+    static int64_t positionalRead(const int fd, const std::span<std::byte> buffer, const uint64_t offset) {
+#ifdef __linux__
+        const auto result = pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+        return result < 0 ? -errno : result;
+#elif _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read = 0;
+        const auto bytes = static_cast<DWORD>(std::min<size_t>(buffer.size(), MAXDWORD));
+        if (!ReadFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), buffer.data(), bytes, &read, &overlapped)) {
+            return GetLastError() == ERROR_HANDLE_EOF ? 0 : -EIO;
+        }
+        return read;
+#endif
+    }
+
+    // Reap io_uring completions and queue their callbacks, one lock per batch, until stopped and drained
+    void reapLoop() {
+        std::vector<std::pair<uint64_t, int64_t>> completions;
+        std::vector<IoRequest*> completed;
+        auto stopping = false;
+        while (true) {
+            m_ioRing.reap([&](const uint64_t userData, const int64_t result) {
+                completions.emplace_back(userData, result);
+            });
+            {
+                // Requests are only touched under the lock they were submitted with, which also makes
+                // their hand-over through the kernel visible to race detectors
+                std::lock_guard guard(m_ioMutex);
+                for (const auto& [userData, result] : completions) {
+                    if (userData == 0) {    // Nop of stopAsyncIo()
+                        stopping = true;
+                        continue;
+                    }
+                    const auto request = reinterpret_cast<IoRequest*>(userData);
+                    request->reaped = true;
+                    request->result = result;
+                    completed.push_back(request);
+                    --m_ioInFlight;
+                }
+                completions.clear();
+                // Submit reads that waited for a free entry
+                while (!m_ioBacklog.empty() && m_ioInFlight < m_ioRing.entries()
+                       && submitRead(*m_ioBacklog.front())) {
+                    m_ioBacklog.pop_front();
+                }
+                if (stopping && m_ioInFlight == 0 && m_ioBacklog.empty()) {
+                    stopping = false;
+                    m_ioRing.close();
+                }
+            }
+            if (!completed.empty()) {
+                std::lock_guard guard(m_mutex);
+                for (const auto request : completed) {
+                    push(IoCompletion{ request }, request->priority, request->tag, request->location, releaseIoRequest);
+                }
+                wakeIdle(completed.size());
+                completed.clear();
+            }
+            if (m_ioRing.entries() == 0) {
+                break;
+            }
+        }
+    }
+
+    // Submit a read to the ring; requires m_ioMutex
+    bool submitRead(IoRequest& request) {
+        const auto bytes = static_cast<unsigned>(std::min<size_t>(request.buffer.size(), UINT32_MAX));
+        if (!m_ioRing.read(request.fd, request.buffer.data(), bytes, request.offset, reinterpret_cast<uint64_t>(&request))) {
+            return false;
+        }
+        ++m_ioInFlight;
+        return true;
+    }
+
+    // Descriptor registered with watch()
+    struct Watch {
+        PriorityThreadPool*          pool;
+        int                          fd;
+        uint32_t                     events;            // Interest given to watch()
+        Priority                     priority;
+        std::function<void(uint32_t)> handler;
+        const char*                  tag;
+        std::source_location         location;
+        std::atomic_bool             removed{ false };  // Unwatched, handlers no longer run
+        std::atomic_size_t           references{ 1 };   // Registration plus the queued or running handler
+    };
+
+    // Task running a watch's handler; trivially copyable so it fits std::function's small buffer
+    struct WatchCall {
+        Watch*   watch;
+        uint32_t events;    // Ready events reported by epoll
+
+        void operator()() const {
+            if (!watch->removed.load(std::memory_order_relaxed)) {
+                watch->handler(events);
+            }
+        }
+    };
+
+    // Release hook of watch handlers: re-arms the descriptor, also when the handler was dropped
+    static void releaseWatchCall(const Task& task) {
+        const auto watch = task.target<WatchCall>()->watch;
+        watch->pool->rearm(*watch);
+        if (watch->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete watch;
+        }
+    }
+
+#ifdef __linux__
+    // Create the epoll instance and the leader's wake-up eventfd on first use; requires m_reactorMutex
+    bool openReactor() {
+        if (m_epoll >= 0) {
+            return true;
+        }
+        const auto epoll = epoll_create1(EPOLL_CLOEXEC);
+        const auto wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event event{ EPOLLIN, { .ptr = nullptr } };
+        if (epoll < 0 || wake < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event) != 0) {
+            if (epoll >= 0) {
+                close(epoll);
+            }
+            if (wake >= 0) {
+                close(wake);
+            }
+            return false;
+        }
+        m_epoll = epoll;
+        m_leaderWake = wake;
+        std::lock_guard guard(m_mutex);
+        m_reactorOpen = true;
+        wakeIdle(1);                          // Let a parked worker become the leader
+        return true;
+    }
+
+    // Wait in epoll_wait() as the reactor leader, then queue the handlers of the ready descriptors
+    // under one lock and give up leadership; called with m_mutex not held
+    void leadReactor() {
+        {
+            // Watches unwatched before this wait cannot be reported by it, and the previous
+            // leader is done with its events, so their registration can be dropped now
+            std::lock_guard guard(m_reactorMutex);
+            for (const auto watch : m_retiredWatches) {
+                if (watch->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    delete watch;
+                }
+            }
+            m_retiredWatches.clear();
+        }
+        std::array<epoll_event, 64> events;
+        const auto count = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), -1);
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.ptr == nullptr) {    // Poked for queued tasks: reset the eventfd
+                uint64_t wakeups;
+                [[maybe_unused]] const auto drained = read(m_leaderWake, &wakeups, sizeof(wakeups));
+            }
+        }
+        std::lock_guard guard(m_mutex);
+        size_t queued = 0;
+        for (int i = 0; i < count; ++i) {
+            const auto watch = static_cast<Watch*>(events[i].data.ptr);
+            if (watch == nullptr || watch->removed.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            watch->references.fetch_add(1, std::memory_order_relaxed);
+            push(WatchCall{ watch, events[i].events }, watch->priority, watch->tag, watch->location, releaseWatchCall);
+            ++queued;
+        }
+        m_reactorLeading = false;
+        m_leaderPoked = false;
+        if (runnableLevels() != 0) {
+            // This worker leaves to run a task: wake followers for the other handlers plus one
+            // that takes over as leader, so readiness is still watched meanwhile
+            wakeIdle(std::max<size_t>(queued, 1));
+        }
+    }
+#endif
+
+    // Arm a watched descriptor for its next event unless it was unwatched
+    void rearm(Watch& watch) {
+#ifdef __linux__
+        std::lock_guard guard(m_reactorMutex);
+        if (!watch.removed.load(std::memory_order_relaxed)) {
+            epoll_event event{ watch.events | EPOLLONESHOT, { .ptr = &watch } };
+            epoll_ctl(m_epoll, EPOLL_CTL_MOD, watch.fd, &event);
+        }
+#else
+        static_cast<void>(watch);
+#endif
+    }
+
+    // Queue a single task unless admission control sheds it or the queue is full; an empty policy
+    // means the pool's default rejection policy
+    AddStatus submit(Task&& task, const Priority priority, const std::optional<RejectionPolicy> policy, const char* tag,
+                     const std::source_location& location, void (*releaseTask)(const Task&)) {
+        PRIORITY_THREAD_POOL_FUZZ_POINT();
+        auto status = AddStatus::Queued;
+        auto throwing = false;
+        Worker* woken = nullptr;
+        std::vector<QueuedTask> dropped, evicted;
+        {
+            // Lock mutex for thread safety
+            std::unique_lock lock(m_mutex);
+            if (m_admitting && !admit(priority, dropped)) [[unlikely]] {
+                status = AddStatus::Shed;
+            } else {
+                const auto rejection = policy.value_or(m_capacityOptions.policy);
+                status = reserve(lock, priority, rejection, evicted);
+                throwing = status == AddStatus::Rejected && rejection == RejectionPolicy::Throw;
+            }
+            if (status == AddStatus::Queued) [[likely]] {
+                // Realtime tasks are left to an idle spinner, which needs no wake-up
+                woken = spinnerTakes(priority) ? nullptr : popIdle();
+                // With nothing queued the task has the highest priority, so a parked worker can take
+                // it directly, without a queue round trip or re-locking the mutex. Generators stay
+                // queued so several workers can claim their items. While producers wait on a full
+                // queue, tasks are queued: a worker wakes one producer per task it takes, and that
+                // wake-up would be lost if no task were taken from the queue again.
+                const auto handOff = woken != nullptr && m_tasks.empty() && !m_limiting.load(std::memory_order_relaxed)
+                    && releaseTask != releaseGenerator && m_blockedProducers == 0;
+                // Add task to the queue or the parked worker's slot
+                push(std::move(task), priority, tag, location, releaseTask, handOff ? woken : nullptr);
+                PRIORITY_THREAD_POOL_FUZZ_POINT();
+            }
+        }
+        if (woken != nullptr) {
+            woken->parked.release();
+        }
+        drop(dropped, m_admissionOptions.onDropped);
+        drop(evicted, m_capacityOptions.onEvicted);
+        if (status == AddStatus::Queued) [[likely]] {
+            return status;
+        }
+        if (throwing) {
+            throw std::length_error("task queue is full!");    // Callers release what the task owns
+        }
+        if (status == AddStatus::RanInline) {
+            task();
+        }
+        if (releaseTask != nullptr) {
+            releaseTask(task);
+        }
+        return status;
+    }
+
+    // Make room in a full queue for a task of the given priority according to the rejection policy,
+    // with the mutex held. Returns AddStatus::Queued when the task may be pushed; discarded tasks
+    // are moved to `evicted`.
+    AddStatus reserve(std::unique_lock<std::mutex>& lock, const Priority priority, const RejectionPolicy policy,
+                      std::vector<QueuedTask>& evicted) {
+        const auto full = [this] {
+            return m_capacityOptions.maxQueued != 0 && m_tasks.size() >= m_capacityOptions.maxQueued;
+        };
+        if (!full()) [[likely]] {
+            return AddStatus::Queued;
+        }
+        switch (policy) {
+        case RejectionPolicy::Block:
+            wakeIdle();           // Tasks queued by a bulk add in progress have not been announced yet
+            ++m_blockedProducers;
+            m_notFull.wait(lock, [this, &full] { return m_quit || !full(); });
+            --m_blockedProducers;
+            if (!m_quit) {
+                return AddStatus::Queued;
+            }
+            break;
+        case RejectionPolicy::CallerRuns:
+            m_inlineTasks.fetch_add(1, std::memory_order_relaxed);
+            return AddStatus::RanInline;
+        case RejectionPolicy::DiscardOldest:
+            if (auto oldest = m_tasks.takeOldest(priority, removable)) {
+                evicted.push_back(std::move(*oldest));
+                m_evictedTasks.fetch_add(1, std::memory_order_relaxed);
+                return AddStatus::Queued;
+            }
+            break;
+        case RejectionPolicy::EvictLowest:
+            if (auto lowest = m_tasks.takeLowest(priority, removable)) {
+                evicted.push_back(std::move(*lowest));
+                m_evictedTasks.fetch_add(1, std::memory_order_relaxed);
+                return AddStatus::Queued;
+            }
+            break;
+        default:
+            break;
+        }
+        m_rejectedTasks.fetch_add(1, std::memory_order_relaxed);
+        return AddStatus::Rejected;
+    }
+
+    // Decide with the mutex held whether a task of the given priority is admitted. While shedding,
+    // queued tasks of the shed priorities are moved to `dropped` if the options ask for it.
+    bool admit(const Priority priority, std::vector<QueuedTask>& dropped) {
+        const auto now = elapsed();
+        double overload = 0;    // Worst ratio of oldest-task wait to target
+        for (size_t level = 0; level < PriorityLevels; ++level) {
+            const auto target = m_admissionOptions.targets[level].count();
+            if (target <= 0 || m_tasks.size(Priorities[level]) == 0) {
+                continue;
+            }
+            const auto enqueuedAt = m_tasks.front(Priorities[level]).enqueuedAt;
+            if (enqueuedAt != 0 && enqueuedAt < now) {    // Tasks queued before admission control started are untimed
+                overload = std::max(overload, static_cast<double>(now - enqueuedAt) / static_cast<double>(target));
+            }
+        }
+        size_t shedLevels = 0;
+        while (shedLevels <= priorityIndex(m_admissionOptions.maxShedPriority) && overload > static_cast<double>(shedLevels + 1)) {
+            ++shedLevels;
+        }
+        if (m_admissionOptions.dropQueued) {
+            for (size_t level = 0; level < shedLevels; ++level) {
+                while (auto task = m_tasks.takeOldest(Priorities[level], removable)) {
+                    dropped.push_back(std::move(*task));
+                    m_droppedTasks.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (priorityIndex(priority) < shedLevels) {
+            m_shedTasks.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // Report removed tasks to the given handler, read under the mutex, and release them once it returned
+    void drop(std::vector<QueuedTask>& dropped, const std::function<void(const QueuedTask&)>& handler) {
+        if (dropped.empty()) [[likely]] {
+            return;
+        }
+        std::function<void(const QueuedTask&)> onDropped;
+        {
+            std::lock_guard guard(m_mutex);
+            onDropped = handler;
+        }
+        for (const auto& task : dropped) {
+            if (onDropped) {
+                onDropped(task);
+            }
+            if (task.release != nullptr) {
+                task.release(task.task);
+            }
+        }
+    }
+
+    // State of the adaptive concurrency limiter, guarded by m_mutex
+    struct ConcurrencyLimiter {
+        ConcurrencyLimitOptions              options;
+        size_t                               maxLimit{ 0 };      // Highest limit, the number of workers
+        uint64_t                             adjustedAt{ 0 };    // Time of the last adjustment
+        std::array<size_t, PriorityLevels>   limits{};           // Current limit per level, 0 when unlimited
+        std::array<size_t, PriorityLevels>   running{};          // Tasks started while limiting and still running
+        std::array<double, PriorityLevels>   recent{};           // Short-term average execution time
+        std::array<double, PriorityLevels>   baseline{};         // Uncontended execution time estimate
+    };
+
+    // Worker count of the global pool, frozen once the pool is created
+    struct GlobalBudget {
+        std::mutex mutex;
+        size_t     threads{ std::thread::hardware_concurrency() };
+        bool       claimed{ false };
+    };
+
+    static GlobalBudget& globalBudget() {
+        static GlobalBudget budget;
+        return budget;
+    }
+
+    // Key of the accounting table: the tag if any, otherwise the call site
+    struct CallSite {
+        const char*   tag;     // Tag passed to add()
+        const char*   file;    // File of the add() call, used when untagged
+        uint_least32_t line;   // Line of the add() call, used when untagged
+
+        [[nodiscard]] bool operator==(const CallSite&) const = default;
+    };
+
+    // Hash for CallSite; pointers are compared by identity and merged by name in snapshots
+    struct CallSiteHash {
+        [[nodiscard]] size_t operator()(const CallSite& site) const {
+            return std::hash<const void*>()(site.tag) ^ (std::hash<const void*>()(site.file) << 1) ^ site.line;
+        }
+    };
+
+    // Costs aggregated by one worker for one call site
+    struct CallSiteCost {
+        uint64_t                 tasks{ 0 };
+        std::chrono::nanoseconds cpuTime{ 0 };
+        std::chrono::nanoseconds wallTime{ 0 };
+        std::chrono::nanoseconds queueWait{ 0 };
+    };
+
+    // State owned by one worker thread, aligned so workers never share a cache line
+    struct alignas(CacheLineSize) Worker {
+        uint32_t                 index{ 0 };                      // Position in m_workers
+        PriorityThreadPool*      pool{ nullptr };                 // Owner, to recognize its workers in blockingRegion()
+        bool                     compensating{ false };           // Spawned for a stuck or blocked worker
+        std::atomic_bool         blocking{ false };               // Inside a compensated blocking region
+        std::atomic_bool         retired{ false };                // Thread exited and the slot can be reused
+        std::atomic_uint64_t     startedAt{ 0 };                  // Start of the running task plus one, 0 when idle
+        std::atomic_uint64_t     taskId{ 0 };                     // Id of the running task
+        std::atomic<Priority>    priority{ Priority::Normal };    // Priority of the running task
+        std::atomic<const char*> tag{ nullptr };                  // Tag of the running task
+        uint64_t                 runTime{ 0 };                    // Execution time of the last task while limiting
+        std::binary_semaphore    parked{ 0 };                     // Released to wake the worker from the idle stack
+        std::optional<QueuedTask> handoff;                        // Task given directly to the parked worker
+        std::atomic_uint64_t     priorityChanges{ 0 };            // Successful OS priority changes
+        std::atomic_uint64_t     priorityChangeFailures{ 0 };     // Failed OS priority changes
+        uint64_t                 reportedAt{ 0 };                 // startedAt of the last task the watchdog reported
+        TraceRing                trace;                           // Events recorded by this worker
+        mutable std::mutex       costsMutex;                      // Guards costs against snapshots
+        std::unordered_map<CallSite, CallSiteCost, CallSiteHash> costs; // Costs of the tasks run by this worker
+        std::jthread             thread;                          // Declared last so it is joined first
+    };
+
+    // Start a worker, reusing the slot of a retired worker; requires m_workersMutex
+    void spawnWorker(const bool compensating) {
+        auto& worker = claimWorker(compensating);
+        worker.thread = std::jthread([this, &worker] { workerLoop(worker); });
+    }
+
+    // Find a retired worker slot or add one, for a thread the caller starts; requires m_workersMutex
+    Worker& claimWorker(const bool compensating) {
+        Worker* worker = nullptr;
+        for (const auto& candidate : m_workers) {
+            if (candidate->retired.load(std::memory_order_acquire)) {
+                if (candidate->thread.joinable()) {
+                    candidate->thread.join();  // Already exiting, returns immediately
+                }
+                candidate->retired.store(false, std::memory_order_relaxed);
+                worker = candidate.get();
+                break;
+            }
+        }
+        if (worker == nullptr) {
+            worker = m_workers.emplace_back(std::make_unique<Worker>()).get();
+            worker->index = static_cast<uint32_t>(m_workers.size() - 1);
+            worker->pool = this;
+            if (m_traceCapacity != 0) {
+                worker->trace.allocate(m_traceCapacity);
+            }
+        }
+        worker->compensating = compensating;
+        return *worker;
+    }
+
+    // Stop and join the Realtime spinners, then wake workers for Realtime tasks nobody was woken for;
+    // requires m_workersMutex
+    void stopSpinners() {
+        {
+            std::lock_guard guard(m_mutex);
+            m_idleSpinners.store(0, std::memory_order_relaxed);
+        }
+        for (const auto worker : m_spinners) {
+            worker->thread.request_stop();
+            worker->thread.join();
+            worker->retired.store(true, std::memory_order_release);
+        }
+        m_spinners.clear();
+        std::lock_guard guard(m_mutex);
+        m_idleSpinners.store(0, std::memory_order_relaxed);    // Spinners that were running a task counted themselves idle again
+        wakeIdle(m_tasks.size(Priority::Realtime));
+    }
+
+    // Pin a thread to one core; returns false if the core is invalid or pinning fails
+    static bool pinThread(std::jthread& thread, const int core) {
+#ifdef __linux__
+        if (core < 0 || core >= CPU_SETSIZE) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#elif _WIN32
+        if (core < 0 || core >= 64) {
+            return false;
+        }
+        return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core) != 0;
+#endif
+    }
+
+    // Main loop of a Realtime spinner: polls the Realtime level without parking until stopped
+    void spinLoop(Worker& self, const std::stop_token token) {
+        runningWorker() = &self;            // Lets blockingRegion() compensate Realtime tasks run here
+        m_idleSpinners.fetch_add(1, std::memory_order_relaxed);
+        constexpr auto realtime = 1u << priorityIndex(Priority::Realtime);
+        while (!token.stop_requested()) {
+            if ((m_tasks.levels() & realtime) == 0) [[likely]] {   // Lock-free hint, confirmed under the mutex
+                cpuRelax();
+                continue;
+            }
+            std::unique_lock lock(m_mutex);
+            if (m_tasks.size(Priority::Realtime) == 0) {
+                continue;                          // Another worker was faster
+            }
+            const auto task = takeTask(priorityIndex(Priority::Realtime));
+            m_idleSpinners.fetch_sub(1, std::memory_order_relaxed);
+            const auto depth = m_tasks.size();
+            if (m_blockedProducers != 0) [[unlikely]] {
+                m_notFull.notify_one();
+            }
+            lock.unlock();
+            PRIORITY_THREAD_POOL_PROBE(dequeue, task.id, static_cast<int>(task.priority), depth, task.tag, self.index);
+            record(self.trace, TraceEvent::Dequeue, task.id, task.priority, self.index, depth);
+            run(self, task);
+            m_idleSpinners.fetch_add(1, std::memory_order_relaxed);    // Read under the mutex; a stale count only wakes a worker
+        }
+    }
+
+    // Whether a task of the given priority about to be queued is left to an idle spinner, which
+    // needs no wake-up: only while more spinners are idle than Realtime tasks wait for one.
+    // Requires the mutex.
+    [[nodiscard]] bool spinnerTakes(const Priority priority) const noexcept {
+        return priority == Priority::Realtime
+            && m_idleSpinners.load(std::memory_order_relaxed) > m_tasks.size(Priority::Realtime);
+    }
+
+    // Main loop of a worker thread
+    void workerLoop(Worker& self) {
+        // Get thread ID only once
+#ifdef __linux__
+        const auto threadId = pthread_self();
+        int policy;
+        sched_param param;
+#elif _WIN32
+        const auto threadId = GetCurrentThread();
+#endif
+        runningWorker() = &self;
+        auto lastPriority = Priority::Normal;
+        auto limitedLevel = PriorityLevels;        // Level of the last task started while limiting, if any
+        while (true) {
+            // Locking mutex for thread safety
+            std::unique_lock lock(m_mutex);
+            PRIORITY_THREAD_POOL_FUZZ_POINT();
+            if (limitedLevel != PriorityLevels) [[unlikely]] {
+                limitedTaskFinished(limitedLevel, self.runTime);
+                limitedLevel = PriorityLevels;
+            }
+            QueuedTask task;
+            size_t depth = 0;                      // Queue depth left behind
+            if (!m_quit && runnableLevels() == 0 && !shouldRetire(self)) {
+#ifdef __linux__
+                if (m_reactorOpen && !m_reactorLeading) [[unlikely]] {
+                    // Wait for descriptor readiness instead of parking; other idle workers follow
+                    m_reactorLeading = true;
+                    lock.unlock();
+                    leadReactor();
+                    continue;
+                }
+#endif
+                // Park until a producer hands a task over or wakes this worker to look at the queue
+                m_idleWorkers.push_back(&self);
+                lock.unlock();
+                PRIORITY_THREAD_POOL_FUZZ_POINT();
+                self.parked.acquire();
+                if (!self.handoff) {
+                    continue;                      // Woken without a task, check the queue again
+                }
+                task = std::move(*self.handoff);
+                self.handoff.reset();
+            } else {
+                PRIORITY_THREAD_POOL_FUZZ_POINT();
+                if (shouldRetire(self) && retire()) [[unlikely]] { // If no longer needed as compensation
+                    if (runnableLevels() != 0) {
+                        wakeIdle(1);               // Hand a possibly consumed wake-up to another worker
+                    }
+                    break;
+                }
+                const auto runnable = runnableLevels();
+                if (runnable == 0) [[unlikely]] {  // If no task can run
+                    if (m_quit) [[unlikely]] {     // Check if thread pool is quitting
+                        break;                     // Break the loop if quitting; limited tasks are drained by their workers
+                    }
+                    continue;                      // Continue to wait for tasks if not quitting
+                }
+                // Remove the top priority task whose priority is not at its concurrency limit
+                const auto level = static_cast<size_t>(std::bit_width(runnable)) - 1;
+                task = takeTask(level);
+                depth = m_tasks.size();
+                if (m_blockedProducers != 0) [[unlikely]] {
+                    m_notFull.notify_one();        // A slot freed up for a producer waiting on a full queue
+                }
+                if (m_limiting.load(std::memory_order_relaxed)) [[unlikely]] {
+                    limitedTaskStarted(level);
+                    limitedLevel = level;
+                }
+                lock.unlock();                     // Unlock the mutex
+            }
+            PRIORITY_THREAD_POOL_PROBE(dequeue, task.id, static_cast<int>(task.priority), depth, task.tag, self.index);
+            PRIORITY_THREAD_POOL_FUZZ_POINT();
+
+            record(self.trace, TraceEvent::Dequeue, task.id, task.priority, self.index, depth);
+
+            // If the task priority is the same as the last one or OS priorities are off
+            if (lastPriority == task.priority || !m_osPriority.load(std::memory_order_relaxed)) [[likely]] {
+                run(self, task);
+                continue;
+            }
+            
+            // When the task is priority is different from the last one
+            lastPriority = task.priority;
+            record(self.trace, TraceEvent::PriorityChange, task.id, task.priority, self.index);
+            [[maybe_unused]] const auto priority = static_cast<int>(task.priority); // Gets task priority
+#ifdef __linux__                    
+            // Try to get thread sched parameters on Linux
+            if (pthread_getschedparam(threadId, &policy, &param) == 0) [[likely]] {
+                policy = SCHED_FIFO;
+                param.sched_priority = priority;
+                // Change the thread priority on Linux
+                const auto result = pthread_setschedparam(threadId, policy, &param);
+                PRIORITY_THREAD_POOL_PROBE(priority_change, self.index, priority, result);
+                if (result != 0) [[unlikely]] { // If fails    
+                    priorityChangeFailed(self, result);
+                } else {
+                    increment(self.priorityChanges);
+                }
+            }
+#elif _WIN32
+            // Change the thread priority on Windows
+            if (!SetThreadPriority(threadId, priority)) [[unlikely]] {  // If fails                           
+                priorityChangeFailed(self, static_cast<int>(GetLastError()));
+            } else {
+                increment(self.priorityChanges);
+            }
+#endif
+            run(self, task); // Execute the task
+        }
+        self.retired.store(true, std::memory_order_release);
+    }
+
+    // Take the most recently parked worker off the idle stack, or null if none, in which case the
+    // reactor leader is woken from epoll_wait() to look at the queue; requires m_mutex
+    [[nodiscard]] Worker* popIdle() noexcept {
+        if (m_idleWorkers.empty()) {
+#ifdef __linux__
+            if (m_reactorLeading && !m_leaderPoked) [[unlikely]] {
+                m_leaderPoked = true;
+                const uint64_t wakeup = 1;
+                [[maybe_unused]] const auto written = write(m_leaderWake, &wakeup, sizeof(wakeup));
+            }
+#endif
+            return nullptr;
+        }
+        const auto worker = m_idleWorkers.back();
+        m_idleWorkers.pop_back();
+        return worker;
+    }
+
+    // Wake up to `count` parked workers so they check the queue; requires m_mutex
+    void wakeIdle(size_t count = SIZE_MAX) noexcept {
+        while (count-- != 0) {
+            const auto worker = popIdle();
+            if (worker == nullptr) {
+                break;
+            }
+            worker->parked.release();
+        }
+    }
+
+    // Levels with queued tasks that are not at their concurrency limit; requires m_mutex
+    [[nodiscard]] unsigned runnableLevels() const noexcept {
+        return m_tasks.levels() & ~m_blockedLevels;
+    }
+
+    // Take a concurrency slot for a task of the given level; requires m_mutex
+    void limitedTaskStarted(const size_t level) noexcept {
+        const auto limit = m_limiter.limits[level];
+        if (limit != 0 && ++m_limiter.running[level] >= limit) {
+            m_blockedLevels |= 1u << level;
+        }
+    }
+
+    // Give back a concurrency slot and feed the task's execution time to the limiter; requires m_mutex
+    void limitedTaskFinished(const size_t level, const uint64_t runTime) {
+        auto& limiter = m_limiter;
+        if (limiter.running[level] != 0) {
+            --limiter.running[level];
+        }
+        if ((m_blockedLevels >> level & 1) != 0 && limiter.running[level] < limiter.limits[level]) {
+            m_blockedLevels &= ~(1u << level);
+            wakeIdle(1);                           // Tasks of this level may be waiting for the slot
+        }
+        if (runTime != 0) {
+            // Short-term average of the execution time, and a baseline that follows drops at once but
+            // rises slowly, approximating the uncontended execution time
+            const auto sample = static_cast<double>(runTime);
+            auto& recent = limiter.recent[level];
+            auto& baseline = limiter.baseline[level];
+            recent = recent == 0 ? sample : recent + (sample - recent) * 0.1;
+            baseline = baseline == 0 || recent < baseline ? recent : baseline + (recent - baseline) * 0.001;
+        }
+        const auto now = elapsed();
+        if (!m_limiting.load(std::memory_order_relaxed) ||
+            now - limiter.adjustedAt < static_cast<uint64_t>(std::chrono::nanoseconds(limiter.options.interval).count())) [[likely]] {
+            return;
+        }
+        limiter.adjustedAt = now;
+
+        // AIMD step from the highest priority down, so inflation of a higher priority shrinks all lower limits
+        auto grown = false;
+        double inflation = 0;
+        for (auto adjusted = PriorityLevels; adjusted-- > 0;) {
+            if (limiter.baseline[adjusted] > 0) {
+                inflation = std::max(inflation, limiter.recent[adjusted] / limiter.baseline[adjusted]);
+            }
+            auto& limit = limiter.limits[adjusted];
+            if (limit == 0) {
+                continue;                          // Not limited
+            }
+            if (inflation > limiter.options.tolerance) {
+                limit = std::max(limiter.options.minLimit, static_cast<size_t>(static_cast<double>(limit) * limiter.options.backoff));
+            } else if (limit < limiter.maxLimit) {
+                ++limit;
+                grown = true;
+            }
+            if (limiter.running[adjusted] >= limit) {
+                m_blockedLevels |= 1u << adjusted;
+            } else {
+                m_blockedLevels &= ~(1u << adjusted);
+            }
+        }
+        if (grown) {
+            wakeIdle();
+        }
+    }
+
+    // Count a failed OS priority change; the first failure means the process lacks the capability,
+    // so priority changes are turned off and the handler is told once
+    void priorityChangeFailed(Worker& self, const int error) {
+        increment(self.priorityChangeFailures);
+        if (m_osPriority.exchange(false, std::memory_order_relaxed)) {
+            std::lock_guard guard(m_failureMutex);
+            if (m_priorityChangeFailureHandler) {
+                m_priorityChangeFailureHandler(error);
+            }
+        }
+    }
+
+    // Increment a counter only written by its owning worker, without a locked instruction
+    static void increment(std::atomic_uint64_t& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Compensating workers currently needed, for stuck workers and blocking regions
+    [[nodiscard]] size_t neededCompensation() const {
+        return m_stuckWorkers.load() + m_blockedWorkers.load();
+    }
+
+    // Whether a compensating worker is no longer needed
+    [[nodiscard]] bool shouldRetire(const Worker& self) const {
+        return self.compensating && m_compensatingWorkers.load() > neededCompensation();
+    }
+
+    // Claim the retirement of one compensating worker; false if another one retired first
+    bool retire() {
+        auto compensating = m_compensatingWorkers.load();
+        while (compensating > neededCompensation()) {
+            if (m_compensatingWorkers.compare_exchange_weak(compensating, compensating - 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Spawn compensating workers until there are `wanted`; requires m_workersMutex
+    void compensate(const size_t wanted) {
+        while (m_compensatingWorkers.load() < wanted) {
+            ++m_compensatingWorkers;
+            spawnWorker(true);
+        }
+    }
+
+    // End a compensated blocking region, waking workers so a surplus compensating worker retires
+    void endBlocking(std::atomic_bool& blocking) {
+        blocking.store(false, std::memory_order_relaxed);
+        std::lock_guard guard(m_mutex);    // Order the change with workers about to park
+        --m_blockedWorkers;
+        if (m_compensatingWorkers.load() > neededCompensation()) {
+            wakeIdle();
+        }
+    }
+
+    // Worker running on this thread, or null on other threads
+    PRIORITY_THREAD_POOL_NOINLINE static Worker*& runningWorker() noexcept {
+        static thread_local Worker* worker = nullptr;
+        return worker;
+    }
+
+    // Push a task into the queue; must be called with the mutex held
+    void push(Task&& task, const Priority priority, const char* tag, const std::source_location& location,
+              void (*releaseTask)(const Task&), Worker* handOff = nullptr) {
+        const auto id = m_nextTaskId++;
+        const auto enqueuedAt = m_accounting.load(std::memory_order_relaxed) || m_admitting ? elapsed() : 0;
+        QueuedTask queued{ std::move(task), priority, id, tag, location, enqueuedAt, releaseTask };
+        if (handOff != nullptr) {
+            handOff->handoff.emplace(std::move(queued));    // Read by the worker once its semaphore is released
+        } else {
+            m_tasks.push(std::move(queued));
+        }
+        PRIORITY_THREAD_POOL_PROBE(enqueue, id, static_cast<int>(priority), m_tasks.size(), tag);
+        record(m_producerTrace, TraceEvent::Enqueue, id, priority, TraceRing::Producer, m_tasks.size());
+    }
+
+    // Execute a task on a worker, surrounded by start and end events
+    void run(Worker& self, const QueuedTask& task) {
+        record(self.trace, TraceEvent::Start, task.id, task.priority, self.index);
+        PRIORITY_THREAD_POOL_PROBE(task_start, task.id, static_cast<int>(task.priority), task.tag, self.index);
+        const auto watched = m_watching.load(std::memory_order_relaxed);
+        if (watched) [[unlikely]] {        // Publish the running task to the watchdog
+            self.taskId.store(task.id, std::memory_order_relaxed);
+            self.priority.store(task.priority, std::memory_order_relaxed);
+            self.tag.store(task.tag, std::memory_order_relaxed);
+            self.startedAt.store(elapsed() + 1, std::memory_order_release);
+        }
+        const auto runStart = m_limiting.load(std::memory_order_relaxed) ? elapsed() : 0;
+        if (m_accounting.load(std::memory_order_relaxed)) [[unlikely]] {
+            runAccounted(self, task);
+        } else {
+            task.task();
+        }
+        self.runTime = runStart != 0 ? elapsed() - runStart : 0;
+        if (watched) [[unlikely]] {
+            self.startedAt.store(0, std::memory_order_release);
+        }
+        PRIORITY_THREAD_POOL_PROBE(task_end, task.id, static_cast<int>(task.priority), task.tag, self.index);
+        record(self.trace, TraceEvent::End, task.id, task.priority, self.index);
+        if (task.release != nullptr) [[unlikely]] {
+            task.release(task.task);
+        }
+    }
+
+    // Execute a task and add its costs to the worker's accounting table
+    void runAccounted(Worker& self, const QueuedTask& task) {
+        const auto start = elapsed();
+        const auto cpuStart = threadCpuTime();
+        task.task();
+        const auto cpuTime = threadCpuTime() - cpuStart;
+        const auto end = elapsed();
+
+        const CallSite site{ task.tag, task.tag != nullptr ? nullptr : task.location.file_name(),
+                             task.tag != nullptr ? 0 : task.location.line() };
+        std::lock_guard guard(self.costsMutex);
+        auto& cost = self.costs[site];
+        ++cost.tasks;
+        cost.cpuTime += std::chrono::nanoseconds(cpuTime);
+        cost.wallTime += std::chrono::nanoseconds(end - start);
+        if (task.enqueuedAt != 0 && task.enqueuedAt <= start) {  // Skip tasks queued before accounting started
+            cost.queueWait += std::chrono::nanoseconds(start - task.enqueuedAt);
+        }
+    }
+
+    // Bits of m_recording, one per destination of lifecycle events
+    static constexpr unsigned RecordTrace = 1;             // Per-thread trace rings of startTracing()
+    static constexpr unsigned RecordFlightRecorder = 2;    // Memory-mapped ring of startFlightRecorder()
+
+    // Record an event into the trace ring and the flight recorder, whichever are enabled
+    void record(TraceRing& trace, const TraceEvent event, const uint64_t taskId, const Priority priority,
+                const uint32_t worker, const size_t queueDepth = 0) {
+        const auto recording = m_recording.load(std::memory_order_acquire);    // One load while both are off
+        if (recording == 0) [[likely]] {
+            return;
+        }
+        const TraceRecord record{ elapsed(), taskId, worker, static_cast<uint32_t>(queueDepth), priority, event };
+        if ((recording & RecordTrace) != 0) {
+            trace.push(record);
+        }
+        if ((recording & RecordFlightRecorder) != 0) {
+            m_flightRecorder.push(record);
+        }
+    }
+
+    // Periodically scan the workers for tasks running past their threshold
+    void watchdogLoop(const std::stop_token token) {
+        std::mutex sleepMutex;
+        std::condition_variable_any sleep;
+        while (true) {
+            {
+                std::unique_lock lock(sleepMutex);
+                sleep.wait_for(lock, token, m_watchdogOptions.interval, [] { return false; });
+            }
+            if (token.stop_requested()) {
+                break;
+            }
+
+            std::vector<SlowTask> slowTasks;
+            size_t stuck = 0;
+            {
+                std::lock_guard guard(m_workersMutex);
+                const auto now = elapsed() + 1;
+                for (auto& worker : m_workers) {
+                    const auto startedAt = worker->startedAt.load(std::memory_order_acquire);
+                    if (startedAt == 0 || startedAt > now || worker->blocking.load(std::memory_order_relaxed)) {
+                        continue;
+                    }
+                    const SlowTask task{ worker->index, worker->priority.load(std::memory_order_relaxed),
+                        worker->tag.load(std::memory_order_relaxed), worker->taskId.load(std::memory_order_relaxed),
+                        std::chrono::nanoseconds(now - startedAt) };
+                    // Skip if the worker moved on while the task was being read
+                    if (worker->startedAt.load(std::memory_order_acquire) != startedAt
+                        || task.elapsed < m_watchdogOptions.thresholds[priorityIndex(task.priority)]) {
+                        continue;
+                    }
+                    ++stuck;
+                    if (worker->reportedAt != startedAt) {  // Report each task only once
+                        worker->reportedAt = startedAt;
+                        slowTasks.push_back(task);
+                    }
+                }
+
+                updateStuckWorkers(std::min(stuck, m_watchdogOptions.maxCompensatingWorkers));
+                compensate(neededCompensation());
+            }
+
+            m_slowTasks.fetch_add(slowTasks.size(), std::memory_order_relaxed);
+            if (m_watchdogOptions.onSlowTask) {
+                for (const auto& task : slowTasks) {
+                    m_watchdogOptions.onSlowTask(task);
+                }
+            }
+        }
+    }
+
+    // Publish the number of stuck workers, waking compensating workers that may now retire
+    void updateStuckWorkers(const size_t stuck) {
+        if (m_stuckWorkers.exchange(stuck) > stuck) {
+            std::lock_guard guard(m_mutex);    // Order the change with workers about to park
+            wakeIdle();
+        }
+    }
+
+    // Nanoseconds elapsed since the pool was created
+    [[nodiscard]] uint64_t elapsed() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_epoch).count());
+    }
+
+    // Read-mostly state, checked by every worker for every task
+    alignas(CacheLineSize)
+    std::atomic_bool            m_quit{ false };  // Atomic boolean flag for indicating quitting
+    std::atomic<unsigned>       m_recording{ 0 };                            // Where lifecycle events are recorded, 0 when nowhere
+    std::atomic_bool            m_watching{ false };                         // Whether workers publish running tasks
+    std::atomic_bool            m_accounting{ false };                       // Whether task costs are aggregated
+    std::atomic_bool            m_limiting{ false };                         // Whether concurrency is limited per priority
+    std::atomic_bool            m_osPriority{ true };                        // Whether workers change OS priorities
+    const std::chrono::steady_clock::time_point m_epoch{ std::chrono::steady_clock::now() }; // Trace time origin
+    FlightRecorder              m_flightRecorder;                            // Memory-mapped event ring
+
+    // Queue state, touched by producers and workers with the mutex held
+    // Plain mutex rather than std::shared_mutex: glibc's rwlock spins while a preempted thread
+    // finishes handing it over, which livelocks once workers run with SCHED_FIFO priorities
+    alignas(CacheLineSize)
+    mutable std::mutex          m_mutex;          // Mutex for thread safety
+    TasksPriorityQueue          m_tasks;          // Priority queue for tasks
+    uint64_t                    m_nextTaskId{ 0 };                           // Next submission sequence number
+    TraceRing                   m_producerTrace;                             // Enqueue events, written under the mutex
+    bool                        m_admitting{ false };                        // Whether admission control runs
+    AdmissionOptions            m_admissionOptions;                          // Settings of admission control
+    unsigned                    m_blockedLevels{ 0 };                        // Levels at their concurrency limit
+    ConcurrencyLimiter          m_limiter;                                   // State of the adaptive concurrency limiter
+    CapacityOptions             m_capacityOptions;                           // Bound of the queue and its rejection policy
+    size_t                      m_blockedProducers{ 0 };                     // Producers waiting on a full queue
+    std::atomic_size_t          m_idleSpinners{ 0 };                         // Realtime spinners not running a task
+    std::pmr::memory_resource* const m_resource;                             // Source of the queue's storage
+
+    // Wake-up state, touched by producers and parking workers with the mutex held
+    alignas(CacheLineSize)
+    std::vector<Worker*>        m_idleWorkers;                               // Parked workers, most recent last
+    bool                        m_reactorOpen{ false };                      // Whether idle workers lead the reactor
+    bool                        m_reactorLeading{ false };                   // Whether a worker waits in epoll_wait()
+    bool                        m_leaderPoked{ false };                      // Whether the leader was woken for tasks
+    std::condition_variable     m_notFull;                                   // Signaled when a full queue frees a slot
+
+    // Cold state: worker management, watchdog and configuration
+    alignas(CacheLineSize)
+    std::atomic_size_t          m_stuckWorkers{ 0 };                         // Stuck workers at last scan, at most maxCompensatingWorkers
+    std::atomic_size_t          m_blockedWorkers{ 0 };                       // Workers in compensated blocking regions
+    std::atomic_size_t          m_compensatingWorkers{ 0 };                  // Live compensating workers
+    std::atomic_uint64_t        m_blockingRegions{ 0 };                      // Compensated blocking regions so far
+    size_t                      m_maxBlockingCompensation{ 0 };              // Blocking regions compensated at once, guarded by m_workersMutex
+    std::atomic_uint64_t        m_slowTasks{ 0 };                            // Tasks reported by the watchdog
+    std::atomic_uint64_t        m_shedTasks{ 0 };                            // Submissions refused by admission control
+    std::atomic_uint64_t        m_droppedTasks{ 0 };                         // Queued tasks removed by admission control
+    std::atomic_uint64_t        m_rejectedTasks{ 0 };                        // Submissions refused on a full queue
+    std::atomic_uint64_t        m_evictedTasks{ 0 };                         // Queued tasks discarded for another
+    std::atomic_uint64_t        m_inlineTasks{ 0 };                          // Submissions run by their caller
+    size_t                      m_traceCapacity{ 0 };                        // Events per trace ring, 0 until allocated
+    std::mutex                  m_failureMutex;                              // Guards the failure handler
+    std::function<void(int)>    m_priorityChangeFailureHandler;              // Told about the first failure
+    WatchdogOptions             m_watchdogOptions;                           // Settings of the running watchdog
+    std::mutex                  m_watchdogMutex;                             // Serializes watchdog start and stop
+    std::jthread                m_watchdog;                                  // Watchdog thread
+    mutable std::mutex          m_workersMutex;                              // Guards the worker list
+    std::vector<std::unique_ptr<Worker>> m_workers;                          // Worker threads and their state
+    std::vector<Worker*>        m_spinners;                                  // Slots of the Realtime spinners
+    std::mutex                  m_ioMutex;                                   // Serializes io_uring submissions
+    IoUring                     m_ioRing;                                    // Ring of readAsync(), closed when not started
+    size_t                      m_ioInFlight{ 0 };                           // Reads submitted and not reaped yet
+    std::deque<IoRequest*>      m_ioBacklog;                                 // Reads waiting for a free ring entry
+    bool                        m_ioStopping{ false };                       // Whether stopAsyncIo() is draining the ring
+    std::jthread                m_ioReaper;                                  // Thread reaping io_uring completions
+    std::mutex                  m_reactorMutex;                              // Guards the watches and epoll registrations
+    int                         m_epoll{ -1 };                               // Reactor epoll instance, -1 until the first watch()
+    int                         m_leaderWake{ -1 };                          // Eventfd waking the reactor leader
+    std::unordered_map<int, Watch*> m_watches;                               // Watched descriptors
+    std::vector<Watch*>         m_retiredWatches;                            // Unwatched, freed by the next leader
+    std::mutex                  m_fibersMutex;                               // Guards the fiber settings and cache
+    FiberOptions                m_fiberOptions;                              // Settings of new fibers
+    std::vector<std::unique_ptr<Fiber>> m_idleFibers;                        // Finished fibers kept for reuse
+
+    friend class FiberEvent;
+};
+
+// Settings of a PoolView
+struct ViewOptions {
+    const char* name{ nullptr };                     // Tag of the view's tasks in watchdog reports and accounting
+    Priority    defaultPriority{ Priority::Normal }; // Priority of tasks added without one
+    Priority    maxPriority{ Priority::Realtime };   // Higher priorities are lowered to this one
+    size_t      maxInFlight{ SIZE_MAX };             // Queued and running tasks above which add() fails
+};
+
+// Counters of a PoolView
+struct ViewStats {
+    uint64_t submitted{ 0 };    // Tasks accepted by add()
+    uint64_t rejected{ 0 };     // Tasks refused because maxInFlight was reached
+    uint64_t completed{ 0 };    // Tasks that finished running
+    uint64_t inFlight{ 0 };     // Tasks queued or running
+};
+
+// Lightweight handle through which a library submits into a shared pool, usually
+// PriorityThreadPool::global(), with its own default priority, quota and counters.
+// Tasks still queued when the view is destroyed run normally.
+class PoolView {
+public:
+    explicit PoolView(ViewOptions options = {}, PriorityThreadPool& pool = PriorityThreadPool::global())
+        : m_pool(pool), m_options(options), m_counters(std::make_shared<Counters>()) {
+        if (m_options.maxInFlight == 0) {
+            throw std::invalid_argument("maxInFlight must be greater than 0!");
+        }
+    }
+
+    // Add a task with the view's default priority; returns false if the quota is exhausted
+    bool add(Task task, const std::source_location location = std::source_location::current()) {
+        return add(std::move(task), m_options.defaultPriority, location);
+    }
+
+    // Add a task, capped at the view's maximum priority; returns false if the quota is exhausted
+    // or the pool shed or rejected the task
+    bool add(Task task, Priority priority, const std::source_location location = std::source_location::current()) {
+        if (m_counters->inFlight.fetch_add(1, std::memory_order_relaxed) >= m_options.maxInFlight) {
+            m_counters->inFlight.fetch_sub(1, std::memory_order_relaxed);
+            m_counters->rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (priorityIndex(priority) > priorityIndex(m_options.maxPriority)) {
+            priority = m_options.maxPriority;
+        }
+        // The counters are shared with the task so it may outlive the view; the in-flight slot is
+        // given back when the task is destroyed, whether it ran or was shed or dropped
+        const auto status = m_pool.add([task = std::move(task), slot = InFlightSlot{ m_counters }] {
+            task();
+            slot.counters->completed.fetch_add(1, std::memory_order_relaxed);
+        }, priority, m_options.name, location);
+        if (status == AddStatus::Shed || status == AddStatus::Rejected) {
+            m_counters->rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_counters->submitted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Get the view's counters
+    [[nodiscard]] ViewStats stats() const {
+        ViewStats stats;
+        stats.submitted = m_counters->submitted.load(std::memory_order_relaxed);
+        stats.rejected = m_counters->rejected.load(std::memory_order_relaxed);
+        stats.completed = m_counters->completed.load(std::memory_order_relaxed);
+        stats.inFlight = m_counters->inFlight.load(std::memory_order_acquire);
+        return stats;
+    }
+
+    // Pool the view submits into
+    [[nodiscard]] PriorityThreadPool& pool() const noexcept {
+        return m_pool;
+    }
+
+private:
+    struct Counters {
+        std::atomic_uint64_t submitted{ 0 };
+        std::atomic_uint64_t rejected{ 0 };
+        std::atomic_uint64_t completed{ 0 };
+        std::atomic_uint64_t inFlight{ 0 };
+    };
+
+    // Holds one unit of the in-flight count. Moves transfer it; a copy, e.g. of a task kept by an
+    // onEvicted handler to retry later, takes a unit of its own, so every copy releases exactly one
+    struct InFlightSlot {
+        std::shared_ptr<Counters> counters;
+
+        InFlightSlot(std::shared_ptr<Counters> owner) noexcept : counters(std::move(owner)) {}
+        InFlightSlot(InFlightSlot&& other) noexcept = default;
+        InFlightSlot& operator=(const InFlightSlot&) = delete;
+
+        InFlightSlot(const InFlightSlot& other) noexcept : counters(other.counters) {
+            if (counters) {
+                counters->inFlight.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        ~InFlightSlot() {
+            if (counters) {
+                counters->inFlight.fetch_sub(1, std::memory_order_release);
+            }
+        }
+    };
+
+    PriorityThreadPool&       m_pool;       // Pool tasks are submitted into
+    const ViewOptions         m_options;    // Settings given at construction
+    std::shared_ptr<Counters> m_counters;   // Shared with queued tasks
+};
+
+// Event a task can wait on without blocking its worker: a fiber of addFiber() is suspended until
+// set() and its worker runs other tasks meanwhile, while any other thread blocks as usual.
+// The event stays set until reset().
+class FiberEvent {
+public:
+    FiberEvent() = default;
+    FiberEvent(const FiberEvent&) = delete;
+    FiberEvent& operator=(const FiberEvent&) = delete;
+
+    // Wake every waiter and let later waits return immediately
+    void set() {
+        std::vector<PriorityThreadPool::Fiber*> waiters;
+        {
+            std::lock_guard guard(m_mutex);
+            m_set = true;
+            waiters.swap(m_waiters);
+        }
+        m_threads.notify_all();
+        for (const auto fiber : waiters) {
+            fiber->pool->resumeFiber(*fiber);
+        }
+    }
+
+    // Make later waits block again
+    void reset() {
+        std::lock_guard guard(m_mutex);
+        m_set = false;
+    }
+
+    // Whether the event is set
+    [[nodiscard]] bool isSet() const {
+        std::lock_guard guard(m_mutex);
+        return m_set;
+    }
+
+    // Wait until the event is set, suspending the calling fiber if there is one
+    void wait() {
+        std::unique_lock lock(m_mutex);
+        if (m_set) {
+            return;
+        }
+        const auto fiber = PriorityThreadPool::runningFiber();
+        if (fiber == nullptr) {
+            m_threads.wait(lock, [this] { return m_set; });
+            return;
+        }
+        m_waiters.push_back(fiber);
+        fiber->unlockOnLeave = lock.release();    // set() cannot resume the fiber before its context is saved
+        PriorityThreadPool::leaveFiber(*fiber);
+    }
+
+private:
+    mutable std::mutex                       m_mutex;      // Guards the flag and the waiting fibers
+    std::condition_variable                  m_threads;    // Wakes waiting threads that are not fibers
+    std::vector<PriorityThreadPool::Fiber*>  m_waiters;    // Suspended fibers
+    bool                                     m_set{ false };
 };
@@ -0,0 +1,184 @@
+// Replays a task trace through PriorityThreadPool's queue and ordering policy with virtual time,
+// so scheduling changes can be evaluated offline and deterministically.
+//
+// Usage: scheduling_simulator <trace.csv> [--workers N] [--starvation-ms M]
+//   The trace has one task per line: arrival_us,priority,duration_us[,tag]
+//   where priority is Lowest, Low, Normal, High or Realtime. A header line is skipped.
+//   Reports per-priority queue wait, tasks waiting longer than the starvation threshold,
+//   per-tag totals and worker utilization.
+//
+// Build: g++ -std=c++20 -O2 scheduling_simulator.cpp -o scheduling_simulator -pthread
+#include <map>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include "../priority_thread_pool.h"
+
+namespace {
+
+// Task read from the trace
+struct TraceTask {
+    double      arrival;     // Microseconds
+    Priority    priority;
+    double      duration;    // Microseconds
+    std::string tag;
+};
+
+// Parse a priority name or its numeric value
+bool parsePriority(const std::string& text, Priority& priority) {
+    for (const auto candidate : Priorities) {
+        std::ostringstream name;
+        name << candidate;
+        if (name.str() == text || std::to_string(static_cast<int>(candidate)) == text) {
+            priority = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read the trace, sorted by arrival time
+bool readTrace(const char* path, std::vector<TraceTask>& tasks) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    size_t number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string arrival, priority, duration, tag;
+        std::getline(fields, arrival, ',');
+        std::getline(fields, priority, ',');
+        std::getline(fields, duration, ',');
+        std::getline(fields, tag);
+        TraceTask task{ 0, Priority::Normal, 0, tag };
+        try {
+            task.arrival = std::stod(arrival);
+            task.duration = std::stod(duration);
+        } catch (const std::exception&) {
+            if (number == 1) {
+                continue;    // Header line
+            }
+            std::cerr << path << ":" << number << ": invalid number" << std::endl;
+            return false;
+        }
+        if (!parsePriority(priority, task.priority)) {
+            std::cerr << path << ":" << number << ": unknown priority " << priority << std::endl;
+            return false;
+        }
+        tasks.push_back(std::move(task));
+    }
+    std::stable_sort(tasks.begin(), tasks.end(), [](const auto& first, const auto& second) {
+        return first.arrival < second.arrival;
+    });
+    return true;
+}
+
+// Sample at the given fraction of sorted samples
+double percentile(const std::vector<double>& sorted, const double fraction) {
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * static_cast<double>(sorted.size())))];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace.csv> [--workers N] [--starvation-ms M]" << std::endl;
+        return 1;
+    }
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    double starvationUs = 1000 * 1000;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const std::string_view option(argv[i]);
+        if (option == "--workers") {
+            workers = std::max<size_t>(1, std::stoul(argv[i + 1]));
+        } else if (option == "--starvation-ms") {
+            starvationUs = std::stod(argv[i + 1]) * 1000;
+        }
+    }
+
+    std::vector<TraceTask> trace;
+    if (!readTrace(argv[1], trace)) {
+        return 1;
+    }
+
+    // Event loop over virtual time; the queue holds trace indexes in QueuedTask::id and the
+    // arrival time in QueuedTask::enqueuedAt, ordered exactly as the pool orders them
+    TasksPriorityQueue queue;
+    std::vector<double> busyUntil(workers, 0);      // Virtual time each worker becomes free
+    std::vector<double> waits(trace.size(), 0);     // Queue wait of each task
+    double now = 0, busy = 0, end = 0;
+    size_t next = 0, started = 0;
+    while (started < trace.size()) {
+        // Advance to the next arrival or worker completion, whichever comes first
+        auto wake = next < trace.size() ? trace[next].arrival : std::numeric_limits<double>::max();
+        if (!queue.empty()) {
+            for (const auto until : busyUntil) {
+                wake = std::min(wake, std::max(until, now));    // A worker freed by a zero-length task is free now
+            }
+        }
+        now = std::max(now, wake);
+        while (next < trace.size() && trace[next].arrival <= now) {
+            const auto& task = trace[next];
+            queue.push({ {}, task.priority, next, nullptr, std::source_location::current(), static_cast<uint64_t>(task.arrival * 1000) });
+            ++next;
+        }
+        for (auto& until : busyUntil) {
+            if (until > now || queue.empty()) {
+                continue;
+            }
+            const auto index = queue.top().id;
+            queue.pop();
+            waits[index] = now - trace[index].arrival;
+            until = now + trace[index].duration;
+            busy += trace[index].duration;
+            end = std::max(end, until);
+            ++started;
+        }
+    }
+
+    // Per-priority wait distribution and starvation
+    std::map<size_t, std::vector<double>, std::greater<>> byPriority;
+    std::map<std::string, std::pair<size_t, double>> byTag;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        byPriority[priorityIndex(trace[i].priority)].push_back(waits[i]);
+        auto& [count, wait] = byTag[trace[i].tag];
+        ++count;
+        wait += waits[i];
+    }
+    std::cout << std::fixed << std::setprecision(1)
+              << "tasks " << trace.size() << ", workers " << workers << ", makespan " << end << " us, utilization "
+              << (end > 0 ? 100 * busy / (end * static_cast<double>(workers)) : 0) << "%\n\n"
+              << std::left << std::setw(10) << "priority" << std::right << std::setw(10) << "tasks"
+              << std::setw(14) << "mean wait us" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+              << std::setw(12) << "max us" << std::setw(10) << "starved" << "\n";
+    for (auto& [index, samples] : byPriority) {
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        size_t starved = 0;
+        for (const auto wait : samples) {
+            total += wait;
+            starved += wait > starvationUs;
+        }
+        std::ostringstream name;
+        name << Priorities[index];
+        std::cout << std::left << std::setw(10) << name.str() << std::right << std::setw(10) << samples.size()
+                  << std::setw(14) << total / static_cast<double>(samples.size()) << std::setw(12) << percentile(samples, 0.5)
+                  << std::setw(12) << percentile(samples, 0.99) << std::setw(12) << samples.back()
+                  << std::setw(10) << starved << "\n";
+    }
+    std::cout << "\n" << std::left << std::setw(24) << "tag" << std::right << std::setw(10) << "tasks"
+              << std::setw(14) << "mean wait us" << "\n";
+    for (const auto& [tag, totals] : byTag) {
+        std::cout << std::left << std::setw(24) << (tag.empty() ? "(untagged)" : tag) << std::right
+                  << std::setw(10) << totals.first << std::setw(14) << totals.second / static_cast<double>(totals.first) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,722 @@
+// Concurrency stress and schedule-fuzzing harness for PriorityThreadPool.
+//
+// Usage: stress [--iterations N] [--seed S] [--timeout-s T]
+//   Each iteration runs randomized producers, priorities, nested submissions, bulk adds and
+//   shutdown timing, with random yields and sleeps injected at the pool's lock and condition
+//   variable points. It checks that:
+//   - no task is lost and no iteration hangs
+//   - a worker drains a backlog in priority order
+//   - bursts of tasks handed to parked workers all run while the pool is alive
+//   - every generator item runs exactly once
+//   - a bounded queue never exceeds its cap, and every rejection policy reports what it did
+//   - adaptive concurrency limits stay in range, never stall limited tasks, and recover
+//   - a bounded queue holds its cap around a queued fiber resumption and never discards it
+//   - a Realtime task waiting on a nested one does not stall behind a busy spinner
+//   - an evicted task is released right after its handler returns
+//   - on Linux, every byte written to watched socketpairs and pipes reaches a handler across
+//     watch/unwatch churn, and a busy handler does not delay other descriptors' handlers
+//   A failure prints the seed that reproduces it.
+//
+// Build: g++ -std=c++20 -O1 -g -fsanitize=thread stress.cpp -o stress -pthread
+//        (or -fsanitize=address,undefined, or -O2 without sanitizers for more iterations)
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#ifdef __linux__
+#   include <sys/socket.h>
+#endif
+
+namespace fuzz {
+
+std::atomic_uint64_t seed{ 1 };    // Seed of the current iteration
+
+// Inject a yield or a short sleep at roughly one in eight fuzz points
+inline void point() {
+    thread_local std::minstd_rand random;
+    thread_local uint64_t randomSeed = 0;
+    if (randomSeed != seed.load(std::memory_order_relaxed)) {
+        randomSeed = seed.load(std::memory_order_relaxed);
+        random.seed(static_cast<unsigned>(randomSeed ^ std::hash<std::thread::id>()(std::this_thread::get_id())));
+    }
+    switch (random() % 16) {
+    case 0:
+        std::this_thread::yield();
+        break;
+    case 1:
+        std::this_thread::sleep_for(std::chrono::microseconds(random() % 50));
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace fuzz
+
+#define PRIORITY_THREAD_POOL_FUZZ_POINT() fuzz::point()
+#include "../priority_thread_pool.h"
+
+namespace {
+
+// Abort with the seed if a check fails
+void check(const bool condition, const char* what, const uint64_t seed) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << " (seed " << seed << ")" << std::endl;
+        std::abort();
+    }
+}
+
+// Wait until a condition holds or a deadline passes; returns whether it holds
+template<typename Condition>
+bool waitUntil(Condition&& condition, const std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+// Random producers, priorities, bulk adds and nested submissions, followed by destruction of the
+// pool at a random point; every submitted task must still run
+void lostTasks(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    std::atomic_uint64_t submitted{ 0 }, executed{ 0 };
+    {
+        PriorityThreadPool pool(1 + random() % 4);
+        pool.setOsPriorityEnabled(random() % 2 == 0);
+        std::vector<std::jthread> producers;
+        const auto producerCount = 1 + random() % 4;
+        for (size_t p = 0; p < producerCount; ++p) {
+            producers.emplace_back([&, producerSeed = random()] {
+                std::minstd_rand local(producerSeed);
+                const auto tasks = local() % 200;
+                for (size_t i = 0; i < tasks; ++i) {
+                    const auto priority = Priorities[local() % std::size(Priorities)];
+                    switch (local() % 4) {
+                    case 0: {   // Bulk add
+                        std::vector<TaskPriority> batch;
+                        for (auto n = local() % 8; n > 0; --n) {
+                            batch.emplace_back([&] { executed.fetch_add(1); }, Priorities[local() % std::size(Priorities)]);
+                        }
+                        submitted.fetch_add(batch.size());
+                        pool.add(batch);
+                        break;
+                    }
+                    case 1:     // Nested submission from inside a task
+                        submitted.fetch_add(2);
+                        pool.add([&pool, &submitted, &executed, priority] {
+                            pool.add([&executed] { executed.fetch_add(1); }, priority);
+                            executed.fetch_add(1);
+                        }, priority);
+                        break;
+                    default:
+                        submitted.fetch_add(1);
+                        pool.add([&executed] { executed.fetch_add(1); }, priority);
+                        break;
+                    }
+                }
+            });
+        }
+        producers.clear();
+        // Shut down after a random delay, while nested submissions may still be adding tasks
+        std::this_thread::sleep_for(std::chrono::microseconds(random() % 200));
+    }
+    check(executed.load() == submitted.load(), "every submitted task runs before the pool is destroyed", seed);
+}
+
+// A single worker blocked behind a gate must drain a random backlog from highest to lowest priority
+void priorityOrder(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    std::vector<size_t> order;
+    std::mutex orderMutex;
+    {
+        PriorityThreadPool pool(1);
+        std::atomic_bool open{ false }, blocked{ false };
+        pool.add([&] {
+            blocked = true;
+            open.wait(false);
+        }, Priority::Realtime);
+        while (!blocked) {
+            std::this_thread::yield();
+        }
+        for (auto n = random() % 500; n > 0; --n) {
+            const auto priority = Priorities[random() % std::size(Priorities)];
+            pool.add([&order, &orderMutex, priority] {
+                std::lock_guard guard(orderMutex);
+                order.push_back(priorityIndex(priority));
+            }, priority);
+        }
+        open = true;
+        open.notify_all();
+    }
+    check(std::is_sorted(order.rbegin(), order.rend()), "a worker runs queued tasks from highest to lowest priority", seed);
+}
+
+// Bursts of submissions to a pool whose workers parked, so tasks are handed straight to a parked
+// worker's slot; every task must run while the pool is alive, as a lost wake-up would leave it
+// queued until destruction drains the queue
+void handOffWakeups(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    std::atomic_uint64_t submitted{ 0 }, executed{ 0 };
+    PriorityThreadPool pool(1 + random() % 4);
+    pool.setOsPriorityEnabled(false);
+    for (auto round = 1 + random() % 8; round > 0; --round) {
+        std::this_thread::sleep_for(std::chrono::microseconds(random() % 500));    // Let workers park
+        std::vector<std::jthread> producers;
+        for (auto p = 1 + random() % 3; p > 0; --p) {
+            producers.emplace_back([&, producerSeed = random()] {
+                std::minstd_rand local(producerSeed);
+                for (auto n = 1 + local() % 8; n > 0; --n) {
+                    const auto priority = Priorities[local() % std::size(Priorities)];
+                    submitted.fetch_add(1);
+                    if (local() % 4 == 0) {    // Nested submission from a worker that may be the only one awake
+                        submitted.fetch_add(1);
+                        pool.add([&pool, &executed, priority] {
+                            pool.add([&executed] { executed.fetch_add(1); }, priority);
+                            executed.fetch_add(1);
+                        }, priority);
+                    } else {
+                        pool.add([&executed] { executed.fetch_add(1); }, priority);
+                    }
+                    if (local() % 4 == 0) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(local() % 100));
+                    }
+                }
+            });
+        }
+        producers.clear();
+        check(waitUntil([&] { return executed.load() == submitted.load(); }, std::chrono::seconds(10)),
+              "a task handed to a parked worker runs without waiting for destruction", seed);
+    }
+}
+
+// Generators of random sizes and priorities next to plain tasks, with the pool destroyed while
+// items may still be pending or waited for first: every item must run exactly once
+void generatorItems(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    std::vector<std::vector<std::atomic_uint8_t>> runs(1 + random() % 6);
+    std::atomic_uint64_t plainSubmitted{ 0 }, plainExecuted{ 0 }, itemsExecuted{ 0 };
+    uint64_t items = 0;
+    {
+        PriorityThreadPool pool(1 + random() % 4);
+        pool.setOsPriorityEnabled(random() % 2 == 0);
+        std::jthread producer([&, producerSeed = random()] {
+            std::minstd_rand local(producerSeed);
+            for (auto n = local() % 100; n > 0; --n) {
+                plainSubmitted.fetch_add(1);
+                pool.add([&plainExecuted] { plainExecuted.fetch_add(1); }, Priorities[local() % std::size(Priorities)]);
+            }
+        });
+        for (auto& generator : runs) {
+            generator = std::vector<std::atomic_uint8_t>(random() % 500);
+            items += generator.size();
+            pool.addGenerator(Priorities[random() % std::size(Priorities)], generator.size(), [&generator, &itemsExecuted](const size_t index) {
+                generator[index].fetch_add(1);
+                itemsExecuted.fetch_add(1);
+            });
+        }
+        producer.join();
+        if (random() % 2 == 0) {    // Otherwise destruction drains what is left
+            check(waitUntil([&] { return itemsExecuted.load() == items && plainExecuted.load() == plainSubmitted.load(); },
+                            std::chrono::seconds(10)), "generator items run while the pool is alive", seed);
+        }
+    }
+    for (const auto& generator : runs) {
+        check(std::all_of(generator.begin(), generator.end(), [](const auto& count) { return count.load() == 1; }),
+              "every generator item runs exactly once", seed);
+    }
+    check(plainExecuted.load() == plainSubmitted.load(), "plain tasks next to generators run", seed);
+}
+
+// Producers filling a bounded queue under each rejection policy: the queue must never exceed its
+// cap, every outcome must match the policy and the stats, and every queued task that was not
+// evicted must run
+void capacityBounds(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    for (const auto policy : { RejectionPolicy::Block, RejectionPolicy::Throw, RejectionPolicy::Reject,
+                               RejectionPolicy::CallerRuns, RejectionPolicy::DiscardOldest, RejectionPolicy::EvictLowest }) {
+        const auto maxQueued = 1 + random() % 8;
+        std::atomic_uint64_t queued{ 0 }, rejected{ 0 }, thrown{ 0 }, inlined{ 0 }, evicted{ 0 }, executed{ 0 };
+        PoolStats stats;
+        {
+            PriorityThreadPool pool(1 + random() % 3);
+            pool.setOsPriorityEnabled(false);
+            pool.setCapacity({ .maxQueued = maxQueued, .policy = policy,
+                               .onEvicted = [&evicted](const QueuedTask&) { evicted.fetch_add(1); } });
+            std::vector<std::jthread> producers;
+            for (auto p = 1 + random() % 3; p > 0; --p) {
+                producers.emplace_back([&, producerSeed = random()] {
+                    std::minstd_rand local(producerSeed);
+                    for (auto n = local() % 200; n > 0; --n) {
+                        const auto pause = local() % 4 == 0 ? local() % 50 : 0;    // Slow tasks let the queue fill
+                        try {
+                            switch (pool.add([&executed, pause] {
+                                std::this_thread::sleep_for(std::chrono::microseconds(pause));
+                                executed.fetch_add(1);
+                            }, Priorities[local() % std::size(Priorities)])) {
+                            case AddStatus::Queued:
+                                queued.fetch_add(1);
+                                break;
+                            case AddStatus::Rejected:
+                                rejected.fetch_add(1);
+                                break;
+                            case AddStatus::RanInline:
+                                inlined.fetch_add(1);
+                                break;
+                            default:
+                                check(false, "only admission control sheds tasks", seed);
+                            }
+                        } catch (const std::length_error&) {
+                            thrown.fetch_add(1);
+                        }
+                        check(pool.remainingTasks() <= maxQueued, "a bounded queue never exceeds its cap", seed);
+                    }
+                });
+            }
+            producers.clear();
+            stats = pool.stats();
+        }
+        const auto only = [&](const std::initializer_list<const std::atomic_uint64_t*> allowed) {
+            for (const auto counter : { &rejected, &thrown, &inlined, &evicted }) {
+                if (counter->load() != 0 && std::find(allowed.begin(), allowed.end(), counter) == allowed.end()) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        switch (policy) {
+        case RejectionPolicy::Block:
+            check(only({}), "Block neither rejects, runs inline nor evicts", seed);
+            break;
+        case RejectionPolicy::Throw:
+            check(only({ &thrown }), "Throw only throws", seed);
+            break;
+        case RejectionPolicy::Reject:
+            check(only({ &rejected }), "Reject only rejects", seed);
+            break;
+        case RejectionPolicy::CallerRuns:
+            check(only({ &inlined }), "CallerRuns only runs tasks inline", seed);
+            break;
+        default:
+            check(only({ &rejected, &evicted }), "DiscardOldest and EvictLowest only reject or evict", seed);
+            break;
+        }
+        check(stats.rejectedTasks == rejected + thrown && stats.evictedTasks == evicted && stats.inlineTasks == inlined,
+              "the stats count every rejected, evicted and inline task", seed);
+        check(executed.load() == queued + inlined - evicted, "every queued task that was not evicted runs", seed);
+    }
+}
+
+// The adaptive limiter with random options: invalid options are refused, limits stay between
+// minLimit and the worker count while inflated tasks shrink them, limited tasks keep running, and
+// once tasks are fast again every limit grows back to the worker count
+void limiterRecovery(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    const auto workers = 2 + random() % 3;
+    ConcurrencyLimitOptions options;
+    options.maxLimitedPriority = Priorities[random() % 3];
+    options.tolerance = 1.1 + static_cast<double>(random() % 10) / 10;
+    options.backoff = 0.3 + static_cast<double>(random() % 6) / 10;
+    options.minLimit = 1 + random() % 2;
+    options.interval = std::chrono::milliseconds(1 + random() % 3);
+    const auto limited = priorityIndex(options.maxLimitedPriority) + 1;    // Number of limited levels
+    const auto maxLimit = std::max<size_t>(workers, options.minLimit);
+    std::atomic_uint64_t submitted{ 0 }, executed{ 0 };
+    PriorityThreadPool pool(workers);
+    pool.setOsPriorityEnabled(false);
+
+    for (const auto& invalid : { ConcurrencyLimitOptions{ .minLimit = 0 }, ConcurrencyLimitOptions{ .backoff = 1 },
+                                 ConcurrencyLimitOptions{ .tolerance = 1 } }) {
+        auto refused = false;
+        try {
+            pool.startConcurrencyLimit(invalid);
+        } catch (const std::invalid_argument&) {
+            refused = true;
+        }
+        check(refused, "invalid limiter options are refused", seed);
+    }
+    pool.startConcurrencyLimit(options);
+    auto limiting = true;
+
+    const auto limitsValid = [&] {
+        const auto limits = pool.stats().concurrencyLimits;
+        for (size_t level = 0; level < PriorityLevels; ++level) {
+            if (level < limited ? limits[level] < options.minLimit || limits[level] > maxLimit : limits[level] != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    // Add tasks of the given duration at random limited priorities and wait until they ran
+    const auto wave = [&](const std::chrono::microseconds duration, const size_t count) {
+        for (auto n = count; n > 0; --n) {
+            submitted.fetch_add(1);
+            pool.add([&executed, duration] {
+                std::this_thread::sleep_for(duration);
+                executed.fetch_add(1);
+            }, Priorities[random() % limited]);
+            check(!limiting || limitsValid(), "limits stay between minLimit and the worker count", seed);
+        }
+        check(waitUntil([&] { return executed.load() == submitted.load(); }, std::chrono::seconds(10)),
+              "limited tasks keep running", seed);
+    };
+    wave(std::chrono::microseconds(20), 50);                      // Baseline
+    wave(std::chrono::microseconds(20 + random() % 2000), 50);    // Inflated
+    if (random() % 4 == 0) {
+        pool.stopConcurrencyLimit();
+        limiting = false;
+        wave(std::chrono::microseconds(20), 20);
+        check(pool.stats().concurrencyLimits == std::array<size_t, PriorityLevels>{}, "stopping the limiter lifts every limit", seed);
+        return;
+    }
+    const auto recovered = [&] {
+        const auto limits = pool.stats().concurrencyLimits;
+        return std::all_of(limits.begin(), limits.begin() + static_cast<ptrdiff_t>(limited),
+                           [maxLimit](const size_t limit) { return limit == maxLimit; });
+    };
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!recovered() && std::chrono::steady_clock::now() < deadline) {
+        wave(std::chrono::microseconds(20), workers * limited);
+        std::this_thread::sleep_for(options.interval);
+    }
+    check(recovered(), "limits grow back to the worker count once tasks are fast again", seed);
+}
+
+// A fiber's resumption queued behind a blocked worker in a bounded queue, with producers that
+// trigger eviction or shedding: the cap must hold, the resumption must never be discarded in
+// place of a task, and the fiber must finish
+void fiberResumeEviction(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    const auto maxQueued = 1 + random() % 4;
+    const auto policy = random() % 2 == 0 ? RejectionPolicy::EvictLowest : RejectionPolicy::DiscardOldest;
+    std::atomic_uint64_t submitted{ 0 }, executed{ 0 }, removed{ 0 };
+    std::atomic_bool finished{ false };
+    {
+        PriorityThreadPool pool(1);
+        pool.setOsPriorityEnabled(false);
+        FiberEvent ready;
+        std::atomic_bool suspended{ false }, open{ false }, blocked{ false };
+        pool.addFiber([&] {
+            suspended = true;
+            ready.wait();
+            finished = true;
+        }, Priority::Lowest);
+        while (!suspended) {
+            std::this_thread::yield();
+        }
+        // The only worker takes the gate once the fiber left it, so the resumption stays queued
+        pool.add([&] {
+            blocked = true;
+            open.wait(false);
+        }, Priority::Realtime);
+        while (!blocked) {
+            std::this_thread::yield();
+        }
+        ready.set();
+        pool.setCapacity({ .maxQueued = maxQueued, .policy = policy,
+                           .onEvicted = [&removed](const QueuedTask&) { removed.fetch_add(1); } });
+        if (random() % 2 == 0) {    // Shed and drop queued Lowest tasks once they waited a millisecond
+            AdmissionOptions options;
+            options.targets[priorityIndex(Priority::Lowest)] = std::chrono::milliseconds(1);
+            options.maxShedPriority = Priority::Lowest;
+            options.dropQueued = true;
+            options.onDropped = [&removed](const QueuedTask&) { removed.fetch_add(1); };
+            pool.startAdmissionControl(options);
+        }
+        for (auto n = 10 + random() % 50; n > 0; --n) {
+            const auto priority = policy == RejectionPolicy::EvictLowest && random() % 2 == 0 ? Priority::High : Priority::Lowest;
+            if (pool.add([&executed] { executed.fetch_add(1); }, priority) == AddStatus::Queued) {
+                submitted.fetch_add(1);
+            }
+            check(pool.remainingTasks() <= maxQueued, "a queued fiber resumption does not push the queue past its cap", seed);
+            if (random() % 8 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        open = true;
+        open.notify_all();
+    }
+    check(finished.load(), "a fiber resumption is not discarded by eviction or admission control", seed);
+    check(executed.load() + removed.load() == submitted.load(), "every queued task either runs or is reported removed", seed);
+}
+
+// Realtime tasks that wait on nested Realtime tasks while a spinner runs: once the spinner is
+// busy, the nested tasks must wake parked workers instead of waiting for it
+void realtimeNesting(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    std::atomic_uint64_t waited{ 0 }, timedOut{ 0 };
+    {
+        const auto workers = 2 + random() % 3;
+        PriorityThreadPool pool(workers);
+        pool.setOsPriorityEnabled(false);
+        const int cores[] = { static_cast<int>(random() % std::max(1u, std::thread::hardware_concurrency())) };
+        if (!pool.startRealtimeSpinners(cores)) {
+            return;    // Pinning is not permitted here
+        }
+        // Fewer waiting tasks than workers, so a worker stays free for nested tasks even once the
+        // spinner is stopped
+        const auto outer = 1 + random() % (workers - 1);
+        for (auto n = outer; n > 0; --n) {
+            pool.add([&pool, &waited, &timedOut] {
+                const auto nestedRan = std::make_shared<std::atomic_bool>(false);
+                pool.add([nestedRan] { *nestedRan = true; }, Priority::Realtime);
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                while (!*nestedRan && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::yield();
+                }
+                (*nestedRan ? waited : timedOut).fetch_add(1);
+            }, Priority::Realtime);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(random() % 200));
+        if (random() % 2 == 0) {
+            pool.stopRealtimeSpinners();
+        }
+        // Workers quit once the queue is empty during destruction, which would strand a task
+        // still waiting on its nested one
+        while (waited + timedOut != outer) {
+            std::this_thread::yield();
+        }
+    }
+    check(timedOut.load() == 0, "a Realtime task waiting on a nested one does not stall while spinners are busy", seed);
+}
+
+// Memory resource counting its live allocations
+class CountingResource : public std::pmr::memory_resource {
+public:
+    [[nodiscard]] uint64_t live() const noexcept { return m_live.load(); }
+
+private:
+    void* do_allocate(const size_t bytes, const size_t alignment) override {
+        const auto block = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        m_live.fetch_add(1);
+        return block;
+    }
+
+    void do_deallocate(void* block, const size_t bytes, const size_t alignment) override {
+        m_live.fetch_sub(1);
+        std::pmr::new_delete_resource()->deallocate(block, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::atomic_uint64_t m_live{ 0 };
+};
+
+// Tasks evicted from a bounded queue behind a blocked worker: a task with a release hook must
+// still own its storage while the handler runs and lose it once the handler returned, and a copy
+// of a task without one kept by the handler must stay callable
+void evictedTaskOwnership(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    CountingResource resource;
+    std::vector<Task> kept;
+    uint64_t plainSubmitted = 0, resourceSubmitted = 0, resourceEvicted = 0;
+    std::atomic_uint64_t plainRan{ 0 }, resourceRan{ 0 };
+    {
+        PriorityThreadPool pool(1);
+        pool.setOsPriorityEnabled(false);
+        std::atomic_bool open{ false }, blocked{ false };
+        pool.add([&] {
+            blocked = true;
+            open.wait(false);
+        }, Priority::Realtime);
+        while (!blocked) {
+            std::this_thread::yield();
+        }
+        // The handler runs on the submitting thread, the only one here
+        pool.setCapacity({ .maxQueued = 1 + random() % 4, .policy = RejectionPolicy::DiscardOldest,
+                           .onEvicted = [&](const QueuedTask& task) {
+                               if (task.release == nullptr) {
+                                   kept.push_back(task.task);
+                                   return;
+                               }
+                               check(resource.live() != 0, "an evicted task owns its storage while its handler runs", seed);
+                               ++resourceEvicted;
+                           } });
+        for (auto n = random() % 100; n > 0; --n) {
+            if (random() % 2 == 0) {
+                ++resourceSubmitted;
+                pool.add(&resource, [&resourceRan] { resourceRan.fetch_add(1); }, Priority::Low);
+            } else {
+                ++plainSubmitted;
+                pool.add([&plainRan] { plainRan.fetch_add(1); }, Priority::Low);
+            }
+            check(resource.live() == resourceSubmitted - resourceEvicted,
+                  "an evicted task's storage is released once its handler returned", seed);
+        }
+        open = true;
+        open.notify_all();
+    }
+    for (const auto& task : kept) {
+        task();
+    }
+    check(plainRan.load() == plainSubmitted, "a kept copy of an evicted task without release hook runs", seed);
+    check(resourceRan.load() + resourceEvicted == resourceSubmitted && resource.live() == 0,
+          "every resource task either runs or is evicted, and releases its storage", seed);
+}
+
+#ifdef __linux__
+// Writers on random socketpairs and pipes, watched at random priorities, alongside regular tasks
+// and descriptors watched and unwatched while written to; every byte must reach a handler
+void reactorReadiness(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    std::vector<std::array<int, 2>> channels(1 + random() % 16);
+    std::atomic_uint64_t written{ 0 }, received{ 0 }, submitted{ 0 }, executed{ 0 };
+    {
+        PriorityThreadPool pool(1 + random() % 4);
+        pool.setOsPriorityEnabled(false);
+        for (auto& channel : channels) {
+            const auto opened = random() % 2 == 0
+                ? socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, channel.data())
+                : pipe2(channel.data(), O_NONBLOCK | O_CLOEXEC);
+            check(opened == 0, "socketpair or pipe is created", seed);
+            const auto fd = channel[0];
+            check(pool.watch(fd, EPOLLIN, Priorities[random() % std::size(Priorities)], [fd, &received](uint32_t) {
+                char buffer[256];
+                for (ssize_t bytes; (bytes = read(fd, buffer, sizeof(buffer))) > 0;) {
+                    received.fetch_add(static_cast<uint64_t>(bytes));
+                }
+            }), "a new descriptor can be watched", seed);
+        }
+        check(!pool.watch(channels[0][0], EPOLLIN, Priority::Normal, [](uint32_t) {}), "a descriptor is watched once", seed);
+
+        std::vector<std::jthread> writers;
+        for (auto n = 1 + random() % 3; n > 0; --n) {
+            writers.emplace_back([&, writerSeed = random()] {
+                std::minstd_rand local(writerSeed);
+                for (auto i = local() % 300; i > 0; --i) {
+                    const auto& channel = channels[local() % channels.size()];
+                    const char bytes[] = "ready";
+                    const auto size = 1 + local() % sizeof(bytes);
+                    if (write(channel[1], bytes, size) == static_cast<ssize_t>(size)) {
+                        written.fetch_add(size);
+                    }
+                    if (local() % 4 == 0) {
+                        submitted.fetch_add(1);
+                        pool.add([&executed] { executed.fetch_add(1); }, Priorities[local() % std::size(Priorities)]);
+                    }
+                }
+            });
+        }
+        // Churn: descriptors unwatched while their handler may be queued or running
+        for (auto n = random() % 20; n > 0; --n) {
+            int churn[2];
+            check(pipe2(churn, O_NONBLOCK | O_CLOEXEC) == 0, "pipe is created", seed);
+            pool.watch(churn[0], EPOLLIN, Priority::Normal, [](uint32_t) {});
+            static_cast<void>(write(churn[1], "x", 1));
+            if (random() % 2 == 0) {
+                std::this_thread::yield();
+            }
+            check(pool.unwatch(churn[0]), "a watched descriptor can be unwatched", seed);
+            close(churn[0]);
+            close(churn[1]);
+        }
+        writers.clear();
+        check(waitUntil([&] { return received.load() == written.load(); }, std::chrono::seconds(10)),
+              "every byte written to a watched descriptor reaches its handler", seed);
+        for (const auto& channel : channels) {
+            pool.unwatch(channel[0]);
+        }
+    }
+    check(executed.load() == submitted.load(), "tasks submitted alongside watched descriptors run", seed);
+    for (const auto& channel : channels) {
+        close(channel[0]);
+        close(channel[1]);
+    }
+}
+
+// While one handler is busy, readiness of another descriptor must be picked up by an idle
+// worker taking over as reactor leader, not wait for the busy handler to return
+void reactorLeaderHandoff(const uint64_t seed) {
+    std::minstd_rand random(static_cast<unsigned>(seed));
+    int busy[2], other[2];
+    check(pipe2(busy, O_NONBLOCK | O_CLOEXEC) == 0 && pipe2(other, O_NONBLOCK | O_CLOEXEC) == 0, "pipes are created", seed);
+    std::atomic_bool busyStarted{ false }, otherRan{ false }, otherInTime{ false };
+    {
+        PriorityThreadPool pool(2 + random() % 3);
+        pool.setOsPriorityEnabled(false);
+        pool.watch(busy[0], EPOLLIN, Priorities[random() % std::size(Priorities)], [&](uint32_t) {
+            char byte;
+            static_cast<void>(read(busy[0], &byte, 1));
+            busyStarted = true;
+            // Stay busy until the other handler ran; only a timeout ends this when no worker leads
+            otherInTime = waitUntil([&] { return otherRan.load(); }, std::chrono::seconds(5));
+        });
+        pool.watch(other[0], EPOLLIN, Priorities[random() % std::size(Priorities)], [&](uint32_t) {
+            char byte;
+            static_cast<void>(read(other[0], &byte, 1));
+            otherRan = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));    // Let the workers park
+        static_cast<void>(write(busy[1], "b", 1));
+        check(waitUntil([&] { return busyStarted.load(); }, std::chrono::seconds(10)), "a handler runs on readiness", seed);
+        static_cast<void>(write(other[1], "o", 1));
+        check(waitUntil([&] { return otherRan.load(); }, std::chrono::seconds(10)), "the second handler runs", seed);
+        pool.unwatch(busy[0]);
+        pool.unwatch(other[0]);
+    }
+    check(otherInTime.load(), "readiness is watched while a handler keeps its worker busy", seed);
+    for (const auto fd : { busy[0], busy[1], other[0], other[1] }) {
+        close(fd);
+    }
+}
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = 1000, firstSeed = std::random_device()(), timeoutSeconds = 60;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view option(argv[i]);
+        if (option == "--iterations") {
+            iterations = std::stoull(argv[i + 1]);
+        } else if (option == "--seed") {
+            firstSeed = std::stoull(argv[i + 1]);
+        } else if (option == "--timeout-s") {
+            timeoutSeconds = std::stoull(argv[i + 1]);
+        }
+    }
+
+    // Hang detector: abort with the seed if an iteration takes too long
+    std::atomic_uint64_t progress{ 0 };
+    std::jthread hangDetector([&progress, timeoutSeconds](const std::stop_token token) {
+        auto last = progress.load();
+        auto lastChange = std::chrono::steady_clock::now();
+        while (!token.stop_requested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (progress.load() != last) {
+                last = progress.load();
+                lastChange = std::chrono::steady_clock::now();
+            } else if (std::chrono::steady_clock::now() - lastChange > std::chrono::seconds(timeoutSeconds)) {
+                std::cerr << "FAILED: iteration hangs (seed " << fuzz::seed.load() << ")" << std::endl;
+                std::abort();
+            }
+        }
+    });
+
+    for (uint64_t i = 0; i < iterations; ++i) {
+        const auto seed = firstSeed + i;
+        fuzz::seed = seed;
+        lostTasks(seed);
+        priorityOrder(seed);
+        handOffWakeups(seed);
+        generatorItems(seed);
+        capacityBounds(seed);
+        limiterRecovery(seed);
+        fiberResumeEviction(seed);
+        realtimeNesting(seed);
+        evictedTaskOwnership(seed);
+#ifdef __linux__
+        reactorReadiness(seed);
+        reactorLeaderHandoff(seed);
+#endif
+        progress.fetch_add(1);
+    }
+    std::cout << "Passed " << iterations << " iterations starting at seed " << firstSeed << std::endl;
+    return 0;
+}